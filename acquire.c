@@ -0,0 +1,100 @@
+/* ----------------------------------------------------
+ * File    : acquire.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * GPS polling policy, see acquire.h.
+ */
+
+#include <inttypes.h>
+#include "acquire.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+static uint8_t active = FALSE;
+static uint8_t has_2d = FALSE;
+static uint16_t interval = ACQUIRE_FAST;
+static uint16_t polls = 0;
+static uint32_t start = 0;
+static uint32_t first_2d = 0;
+
+uint16_t acquire_fixes = 0;
+uint32_t acquire_polls = 0;
+uint32_t acquire_ttf_sum = 0;
+uint32_t acquire_ttf_max = 0;
+
+
+
+/*
+ * acquire_reset
+ */
+void acquire_reset(void) {
+	active = FALSE;
+}
+
+
+
+/*
+ * acquire_ready
+ * A 2D fix counts against the budget from the first 2D fix of this
+ * acquisition, that is from now if there was none.
+ */
+uint8_t acquire_ready(uint8_t fix, uint8_t min_fix, uint16_t budget, 
+		uint32_t now) {
+	if (fix < 2) {
+		return FALSE;
+	}
+	if (fix >= min_fix) {
+		return TRUE;
+	}
+	return active && has_2d && (budget != 0) && 
+		((now - first_2d) >= budget * 1000UL);
+}
+
+
+
+/*
+ * acquire_poll
+ */
+uint16_t acquire_poll(uint8_t fix, uint8_t sats, uint8_t min_fix, 
+		uint16_t budget, uint32_t now) {
+	uint32_t ttf;
+	uint16_t wait = interval;
+	if (!active) {
+		active = TRUE;
+		has_2d = FALSE;
+		interval = ACQUIRE_FAST;
+		wait = interval;
+		polls = 0;
+		start = now;
+	}
+	polls++;
+	if ((fix >= 2) && !has_2d) {
+		has_2d = TRUE;
+		first_2d = now;
+	}
+	if (acquire_ready(fix, min_fix, budget, now)) {
+		ttf = now - start;
+		acquire_fixes++;
+		acquire_polls += polls;
+		acquire_ttf_sum += ttf;
+		if (ttf > acquire_ttf_max) {
+			acquire_ttf_max = ttf;
+		}
+		active = FALSE;
+		return 0;
+	}
+	if (fix >= 2) {
+		// waiting for 3D, it should be close
+		interval = ACQUIRE_FAST;
+		return interval;
+	}
+	if (sats == 0) {
+		interval = (interval < ACQUIRE_MAX / 2) ? interval * 2 : ACQUIRE_MAX;
+	}
+	return wait;
+}
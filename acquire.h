@@ -0,0 +1,59 @@
+/* ----------------------------------------------------
+ * File    : acquire.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Polling policy while the GPS acquires a fix. Polls are rapid after
+ * a start, back off while no satellites are reported, and snap back
+ * on the first 2D fix. If a 3D fix is wanted, a 2D fix is accepted 
+ * after a budget of time.
+ */
+
+#ifndef ACQUIRE_H_
+#define ACQUIRE_H_
+
+#include <inttypes.h>
+
+#define ACQUIRE_FAST	2000		// ms between polls after a start
+#define ACQUIRE_MAX		60000		// ms, longest backoff
+
+extern uint16_t acquire_fixes;		// fixes acquired
+extern uint32_t acquire_polls;		// polls for these fixes
+extern uint32_t acquire_ttf_sum;	// ms from the start to the fix
+extern uint32_t acquire_ttf_max;
+
+/*
+ * acquire_reset
+ * Starts over with rapid polls, after power up or a GPS restart.
+ */
+void acquire_reset(void);
+
+/*
+ * acquire_ready
+ * Tells if acquire_poll() would accept the fix now, without counting
+ * a poll. Only such a fix needs to be checked any further.
+ * fix		0: none, 2: 2D, 3: 3D
+ * min_fix	fix that is wanted, 2 or 3
+ * budget	s a 3D fix is waited for after the first 2D fix, 0: forever
+ * now		ms
+ * return	uint8_t	TRUE if the fix would be accepted
+ */
+uint8_t acquire_ready(uint8_t fix, uint8_t min_fix, uint16_t budget, 
+	uint32_t now);
+
+/*
+ * acquire_poll
+ * Takes the result of a poll. The first poll after a fix starts a 
+ * new acquisition.
+ * fix		0: none, 2: 2D, 3: 3D
+ * sats		satellites reported by the GPS
+ * min_fix	fix that is wanted, 2 or 3
+ * budget	s a 3D fix is waited for after the first 2D fix, 0: forever
+ * now		ms
+ * return	uint16_t	0 if the fix is accepted, else ms until the next poll
+ */
+uint16_t acquire_poll(uint8_t fix, uint8_t sats, uint8_t min_fix, 
+	uint16_t budget, uint32_t now);
+
+#endif /*ACQUIRE_H_*/
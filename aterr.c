@@ -0,0 +1,96 @@
+/* ----------------------------------------------------
+ * File    : aterr.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Classification of AT command errors, see aterr.h.
+ * The verbose error text is matched against a table of keywords,
+ * the first match wins.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "aterr.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+typedef struct {
+	const char *keyword;
+	uint8_t class;
+} aterr_keyword;
+
+const char busy_P[] PROGMEM       = "busy";
+const char timeout_P[] PROGMEM    = "timeout";
+const char temporary_P[] PROGMEM  = "temporar";
+const char congestion_P[] PROGMEM = "congestion";
+const char service_P[] PROGMEM    = "no network service";
+const char sim_P[] PROGMEM        = "SIM";
+const char password_P[] PROGMEM   = "password";
+const char network_P[] PROGMEM    = "network";
+const char smsc_P[] PROGMEM       = "SMSC";
+
+const aterr_keyword keywords_P[] PROGMEM = {
+	{busy_P, ATERR_TRANSIENT}, 
+	{timeout_P, ATERR_TRANSIENT}, 
+	{temporary_P, ATERR_TRANSIENT}, 
+	{congestion_P, ATERR_TRANSIENT}, 
+	{service_P, ATERR_TRANSIENT},		// not yet registered
+	{sim_P, ATERR_SIM}, 
+	{password_P, ATERR_SIM}, 
+	{network_P, ATERR_NETWORK}, 
+	{smsc_P, ATERR_NETWORK} };
+
+#define KEYWORDS (sizeof(keywords_P) / sizeof(aterr_keyword))
+
+uint16_t aterr_count[ATERR_COUNT];
+
+
+
+/*
+ * aterr_classify
+ */
+uint8_t aterr_classify(const char *response) {
+	uint8_t i;
+	uint8_t class = ATERR_OTHER;
+	if ((response == 0) || (*response == 0)) {
+		class = ATERR_TIMEOUT;
+	}
+	else {
+		for (i = 0; i < KEYWORDS; i++) {
+			if (strstr_P(response, (const char *)pgm_read_word(&keywords_P[i].keyword))) {
+				class = pgm_read_byte(&keywords_P[i].class);
+				break;
+			}
+		}
+	}
+	aterr_count[class]++;
+	return class;
+}
+
+
+
+/*
+ * aterr_retry
+ */
+uint8_t aterr_retry(uint8_t class) {
+	return (class == ATERR_TIMEOUT) || (class == ATERR_TRANSIENT) || 
+		(class == ATERR_NETWORK);
+}
+
+
+
+/*
+ * aterr_backoff
+ */
+uint16_t aterr_backoff(uint8_t attempt) {
+	uint16_t ms = ATERR_BACKOFF_MS;
+	while (attempt-- && (ms < ATERR_BACKOFF_MAX)) {
+		ms <<= 1;
+	}
+	return (ms < ATERR_BACKOFF_MAX) ? ms : ATERR_BACKOFF_MAX;
+}
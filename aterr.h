@@ -0,0 +1,56 @@
+/* ----------------------------------------------------
+ * File    : aterr.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Classification of AT command errors and retry backoff. The 
+ * modem reports verbose errors after AT+CMEE=2, e.g.
+ * "+CME ERROR: SIM busy" or "+CMS ERROR: network timeout".
+ */
+
+#ifndef ATERR_H_
+#define ATERR_H_
+
+#include <inttypes.h>
+
+// error classes
+#define ATERR_TIMEOUT	0	// no response at all
+#define ATERR_TRANSIENT	1	// busy, timeouts, worth a retry
+#define ATERR_SIM		2	// SIM missing, wrong PIN
+#define ATERR_NETWORK	3	// not registered, network rejected
+#define ATERR_OTHER		4	// plain ERROR, unknown errors
+#define ATERR_COUNT		5
+#define ATERR_NONE		0xff	// no error
+
+// retries per command and backoff
+#define ATERR_RETRIES		3
+#define ATERR_BACKOFF_MS	250
+#define ATERR_BACKOFF_MAX	4000
+
+// errors counted per class
+extern uint16_t aterr_count[ATERR_COUNT];
+
+/*
+ * aterr_classify
+ * Classifies an error response and counts it. 
+ * response	the response of the modem, 0 if there was none
+ * return	uint8_t	one of ATERR_*
+ */
+uint8_t aterr_classify(const char *response);
+
+/*
+ * aterr_retry
+ * return	uint8_t	TRUE if errors of the class may go away by 
+ *					repeating the command
+ */
+uint8_t aterr_retry(uint8_t class);
+
+/*
+ * aterr_backoff
+ * return	uint16_t	ms to wait before the given retry, doubled with
+ *					each attempt
+ */
+uint16_t aterr_backoff(uint8_t attempt);
+
+#endif /*ATERR_H_*/
@@ -1,837 +1,2529 @@
-/* ----------------------------------------------------
- * File    : beacon.c
- * Title   : GSM-GPS tracking thing
- * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
- * Hardware: ATmega8, 4.096MHz
- * Software: WinAVR20070525
- *
- * Disclaimer:
- * This software comes "as is". Without any warranty.
- * 
- * License:
- * This is published under the Creative Commons License Attribution-NonCommercial.
- * You are free to distribute and adapt for non-commercial use.
- * See http://creativecommons.org/licenses/by-nc/3.0/ for more details.
- *  
- * History:
- * 2007/07/12	GPS position received from the GM862. Not parsed.
- * 2007/07/28	First SMS with link to google maps sent.
- * 2007/08/08	Sending SMS with positions every 2 minutes
- * 
- * 
- * Known issues:
- * - There is still a bug in the UART routines. Sending may hang with 
- *   large messages. For now it works.
- * 
- * Notes:
- * - Search for EDIT THIS in the source to find part that you need to adapt
- *   to your setting (PIN and SMS number). 
- * 
- * TODO:
- * - Use PIN and SMS from eeprom
- * 
- */
-
-#include <inttypes.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <avr/io.h> 
-#include <avr/interrupt.h>
-#include <avr/eeprom.h>
-#include <avr/pgmspace.h>
-#include <util/delay.h>
-#include "uart.h"
-#include "suart.h"
-
-#define TRUE 1
-#define FALSE 0
-
-#define MONITOR_LED PD4
-#define MODEM_ON_SWITCH PC5
-
-
-// setup a file for printf usage
-FILE uart_file = FDEV_SETUP_STREAM(suart_putc_f, suart_getc_f, _FDEV_SETUP_RW);
-
-
-// types
-typedef struct {
-	const char *name;
-	unsigned char command;
-	void (*work)(void);
-} menu_item;
-
-typedef struct {
-	uint8_t lat_deg;
-	uint32_t lat_min;
-	uint8_t lon_deg;
-	uint32_t lon_min;
-	int32_t alt;
-	uint8_t fix;
-} gps_position;
-
-
-// EEPROM storage
-uint16_t reboot_counter EEMEM = 0;
-uint8_t sms_gateway[15] EEMEM = "7676245";		// EDIT THIS! Where to send the SMS
-uint8_t pin[5] EEMEM = "1067";					// EDIT THIS! Insert your pin
-
-// statics
-
-#define MODEM_OFF			0
-#define MODEM_STARTING		1
-#define MODEM_ON			2
-#define MODEM_SHUTTING_DOWN	3
-#define MODEM_INITIALIZED	4
-#define MODEM_POS_FIX		5
-#define MODEM_ERRORED		6
-
-static volatile uint8_t modem_state = 0;
-
-static volatile uint8_t seconds = 0;
-static volatile uint8_t minutes = 0;
-static volatile uint8_t hours = 0;
-static volatile uint8_t days = 0;
-static volatile uint16_t ms_count = 0;
-
-// current gps position
-static volatile gps_position act_gps_position;
-
-// strings
-const char cr_P[] PROGMEM = "\n";
-const char line_P[] PROGMEM = "------\n";
-const char firmware_P[] PROGMEM = "Beacon v0.03 2007/08/06";
-const char menu_option_P[] PROGMEM = " - ";
-const char prompt_P[] PROGMEM = "key>";
-const char error_unknown_command_P[] PROGMEM = "unknown key: %c\n";
-const char got_P[] PROGMEM = "got: %s\n";
-const char google_maps_P[] PROGMEM = "alex@tinkerlog.com http://maps.google.com/maps?q=%d.%lu,%d.%lu%%28Alex%%29&t=k&z=16";
-const char position_P[] PROGMEM = "%d.%lu %d.%lu %li\n";
-const char ok_P[] PROGMEM = " --> OK\n";
-const char no_response_P[] PROGMEM = " --> NO RESPONSE\n";
-const char no_fix_P[] PROGMEM = "no fix\n";
-const char error_P[] PROGMEM = "ERROR\n";
-const char interactive_P[] PROGMEM = "INTERACTIVE\n";
-const char run_P[] PROGMEM = "RUN\n";
-const char wait_P[] PROGMEM = "waiting ...\n";
-// menu strings
-const char report_P[] PROGMEM = "Report status";
-const char modem_state_P[] PROGMEM = "Modem %d\n";
-const char change_sms_P[] PROGMEM = "Change sms phone number";
-const char menu_P[] PROGMEM = "Menu"; 
-const char change_pin_P[] PROGMEM = "Change pin";
-const char switch_on_P[] PROGMEM = "Switch modem on/off";
-const char init_modem_P[] PROGMEM = "Init modem";
-const char send_sms_P[] PROGMEM = "Send SMS";
-const char cold_gps_P[] PROGMEM = "Cold start GPS";
-const char request_gps_P[] PROGMEM = "Request GPS";
-const char reboots_P[] PROGMEM = "reboots: %d\n";
-const char sms_gateway_P[] PROGMEM = "SMS gateway: %s\n";
-const char pin_P[] PROGMEM = "PIN: %s\n";
-const char uptime_P[] PROGMEM = "uptime: %02dD %02d:%02d:%02d\n";
-// modem strings
-const char AT_P[] PROGMEM       = "AT";					// say hello
-const char OK_P[] PROGMEM       = "\r\nOK\r\n";			// response
-const char ATIPR_P[] PROGMEM    = "AT+IPR=19200";		// use 19200 baud
-const char ATCPIN_P[] PROGMEM   = "AT+CPIN=1067";		// EDIT THIS! send pin
-const char ATCMEE_P[] PROGMEM   = "AT+CMEE=2";			// extended error format
-const char ATCMGF_P[] PROGMEM   = "AT+CMGF=1";			// sms text mode
-const char ATCSCS_P[] PROGMEM	= "AT+CSCS?";			// select char set
-const char ATCMGS_P[] PROGMEM   = "AT+CMGS=\"7676245\"";	// EDIT THIS! send sms
-//const char ATCREG_P[] PROGMEM   = "AT+CREG?";			// network?
-//const char ATGPSR_P[] PROGMEM   = "AT$GPSR=1";		// reset GPS, cold start
-const char ATGPSR_P[] PROGMEM   = "AT$GPSR=2";			// reset GPS, warm start
-const char ATGPSACP_P[] PROGMEM = "AT$GPSACP";			// position request
-
-
-// sequence of commands to initialize the modem
-const char *MODEM_INIT_SEQ[] = {
-	AT_P, ATIPR_P, ATCPIN_P, ATCMEE_P };
-
-
-// prototypes
-void inc_reboot_counter(void);
-void switch_led(void);
-void clock_tick(void);
-void show_report(void);
-
-void show_menu(void);
-void change_sms(void);
-void change_pin(void);
-uint8_t handle_command(uint8_t command);
-
-uint8_t uart_gets_timeout(char *buf, uint16_t timeout);
-void switch_modem(void);
-void init_modem(void);
-void send_sms(char *message);
-void send_position_sms(void);
-void network_status(void);
-void cold_gps(void);
-void request_gps(void);
-char *skip(char *str, char match);
-char *read_token(char *str, char *buf, char delimiter);
-void parse_gps(char *gps_msg);
-
-
-/*
- * Increments the reboot counter.
- */
-void inc_reboot_counter(void) {
-	uint16_t mem_reboots = eeprom_read_word(&reboot_counter);
-	mem_reboots++;
-	eeprom_write_word(&reboot_counter, mem_reboots);
-}
-
-
-/*
- * Switches the modem on and off.
- */
-void switch_modem(void) {
-	uint8_t i = 0;
-
-	PORTC |= (1 << MODEM_ON_SWITCH);
-	for (i = 0; i < 200; i++) {
-		_delay_ms(10);
-	}
-	PORTC &= ~(1 << MODEM_ON_SWITCH);
-	if (modem_state == MODEM_OFF) {
-		modem_state = MODEM_ON;
-	}
-}
-
-
-
-/*
- * Sends a request to the modem and stores the response into
- * the buffer.
- */
-uint8_t request_modem(
-		const char *command, uint16_t timeout, uint8_t check, char *buf) {
-			
-	uint8_t count = 0;
-	char *found = 0;
-
-	printf_P(command);
-	
-	uart_puts_P(command);
-	uart_putc('\r');
-	count = uart_gets_timeout(buf, timeout);
-	if (count) {
-		if (check) {
-			found = strstr_P(buf, OK_P);
-			if (found) {
-				printf_P(ok_P);
-			}
-			else {
-				printf("%d, %s\n", count, buf);  
-				//printf_P(got_P, buf);
-			} 
-		}
-		else {
-			printf("%d, %s\n", count, buf);  
-			//printf_P(cr_P);
-		}
-	}
-	else {
-		printf_P(no_response_P);
-	}
-	return count;
-}
-
-
-
-/*
- * Gets a response from the modem.
- */
-uint8_t uart_gets_timeout(char *buf, uint16_t timeout) {
-	uint8_t count = 0;
-	uint8_t us_count = 0;
-	uint16_t c;
-	*buf = 0;
-	while (timeout) {
-		c = uart_getc();
-		if (c == UART_NO_DATA) {
-			_delay_us(10);
-			if (us_count++ == 100) {
-				timeout--;
-				us_count = 0;
-			}
-		}
-		else {
-			count++;
-			*buf++ = c;
-		}
-	}
-	if (count != 0) {
-		*buf = 0;
-		count++;
-	}
-	return count;
-}
-
-
-
-/*
- * Initializes the modem with an initialization sequence.
- * TODO: send the pin from EEPROM
- */
-void init_modem(void) {
-	char buf[100];
-	uint8_t i = 0;
-	for (i = 0; i < 4; i++) {
-		if (!request_modem(MODEM_INIT_SEQ[i], 1000, TRUE, buf)) {
-			modem_state = MODEM_ERRORED;
-			return;
-		}
-	}
-	modem_state = MODEM_INITIALIZED;
-}
-
-
-
-/*
- * Sends an SMS.
- */
-void send_sms(char *message) {
-	char buf[200];
-
-	request_modem(ATCMGF_P, 1500, TRUE, buf);
-	request_modem(ATCMGS_P, 1500, FALSE, buf);		// TODO: use phone number from eeprom
-	printf_P(got_P, buf);
-	uart_puts(message);
-	uart_putc(0x1a);
-	//uart_putc(0x0d);
-	uart_gets_timeout(buf, 2000);
-	printf_P(got_P, buf);
-	uart_gets_timeout(buf, 4000);
-	printf_P(got_P, buf);
-	
-}
-
-
-
-/*
- * Sends the current position via SMS if it is a valid (fix) 
- * position.
- */
-void send_position_sms(void) {
-	
-	char buf[200];	
-	if (act_gps_position.fix > 0) {
-		sprintf_P(buf, google_maps_P,  
-			act_gps_position.lat_deg, act_gps_position.lat_min,
-			act_gps_position.lon_deg, act_gps_position.lon_min
-		);
-		send_sms(buf);
-	}
-	
-	//send_sms("alex@tinkerlog.com dies ist ein test und der geht uber eine ganze menge zeichen");	
-}
-
-/*
-void network_status(void) {
-	char buf[100];
-	request_modem(ATCREG_P, 1000, FALSE, buf);
-	printf_P(got_P, buf);			
-}
-*/
-
-
-
-/*
- * Starts the GPS over.
- */
-void cold_gps(void) {
-	char buf[100];
-	request_modem(ATGPSR_P, 2000, TRUE, buf);
-	printf_P(got_P, buf);			
-}
-
-
-
-/*
- * Request the GPS position. 
- * Position is parsed and converted and stored globally.
- */
-void request_gps(void) {
-	char buf[150];
-	request_modem(ATGPSACP_P, 4000, FALSE, buf);
-	printf_P(got_P, buf);
-	if (strlen(buf) > 29) {
-		act_gps_position.fix = 0;	// invalidate actual position			
-		parse_gps(buf);
-		if (act_gps_position.fix > 0) {
-			printf_P(position_P,  
-				act_gps_position.lat_deg, act_gps_position.lat_min,
-				act_gps_position.lon_deg, act_gps_position.lon_min, 
-				act_gps_position.alt);
-			modem_state = MODEM_POS_FIX;
-		}
-	}
-	else {
-		act_gps_position.fix = 0;
-		printf_P(no_fix_P);
-		modem_state = MODEM_INITIALIZED;
-	}
-}
-
-
-
-/*
- * Skips the string until the given char is found.
- */
-char *skip(char *str, char match) {
-	uint8_t c = 0;
-	while (TRUE) {
-		c = *str++;
-		if ((c == match) || (c == '\0')) {
-			break;
-		}
-	}
-	return str;
-}
-
-
-
-/*
- * Reads a token from the given string. Token is seperated by the 
- * given delimiter.
- */
-char *read_token(char *str, char *buf, char delimiter) {
-	uint8_t c = 0;
-	while (TRUE) {
-		c = *str++;
-		if ((c == delimiter) || (c == '\0')) {
-			break;
-		}
-		else if (c != ' ') {
-			*buf++ = c;
-		}
-	}
-	*buf = '\0';
-	return str;
-}
-
-
-
-/*
- * Parse and convert the given string into degrees and minutes.
- * Example: 5333.9472N --> 53 degrees, 33.9472 minutes
- * converted to: 53.565786 degrees 
- */
-void parse_degrees(char *str, uint8_t *degree, uint32_t *minutes) {
-	char buf[6];
-	uint8_t c = 0;
-	uint8_t i = 0;
-	char *tmp_str;
-	
-	tmp_str = str;
-	while ((c = *tmp_str++) != '.') i++;
-	strlcpy(buf, str, i-1);
-	*degree = atoi(buf);
-	 	
-	tmp_str -= 3;
-	i = 0;
-	while (TRUE) {
-		c = *tmp_str++;
-		if ((c == '\0') || (i == 5)) {
-			break;
-		}
-		else if (c != '.') {
-			buf[i++] = c;
-		}
-	}
-	buf[i] = 0;
-	*minutes = atol(buf);
-	*minutes *= 16667;
-	*minutes /= 1000;
-}
-
-
-
-/*
- * Parse and convert the position tokens. 
- */
-void parse_position(gps_position *pos, char *lat_str, char *lon_str, char *alt_str) {
-	char buf[10];
-	parse_degrees(lat_str, &pos->lat_deg, &pos->lat_min);
-	parse_degrees(lon_str, &pos->lon_deg, &pos->lon_min);
-	read_token(alt_str, buf, '.');
-	pos->alt = atol(buf);
-}
-
-
-
-/*
- * Parse the given string into a position record.
- * example:
- * $GPSACP: 120631.999,5433.9472N,00954.8768E,1.0,46.5,3,167.28,0.36,0.19,130707,11\r
- */
-void parse_gps(char *gps_msg) {
-
-	char time[7];
-	char lat_buf[12];
-	char lon_buf[12];
-	char alt_buf[7];
-	char fix;
-	char date[7];
-	char nr_sat[4];
-	
-	gps_msg = skip(gps_msg, ':');					// skip prolog
-    gps_msg = read_token(gps_msg, time, '.');		// time, hhmmss
-	gps_msg = skip(gps_msg, ',');					// skip ms
-	gps_msg = read_token(gps_msg, lat_buf, ',');	// latitude
-	gps_msg = read_token(gps_msg, lon_buf, ',');	// longitude
-	gps_msg = skip(gps_msg, ',');					// hdop
-	gps_msg = read_token(gps_msg, alt_buf, ',');	// altitude
-	fix = *gps_msg++;								// fix, 0, 2d, 3d
-	gps_msg++;
-	gps_msg = skip(gps_msg, ',');					// cog, cource over ground
-	gps_msg = skip(gps_msg, ',');					// speed [km]
-	gps_msg = skip(gps_msg, ',');					// speed [kn]
-	gps_msg = read_token(gps_msg, date, ',');		// date ddmmyy
-	gps_msg = read_token(gps_msg, nr_sat, '\n');	// number of sats
-
-	if (fix != '0') {
-		parse_position(&act_gps_position, lat_buf, lon_buf, alt_buf);
-		act_gps_position.fix = fix;
-	}
-
-}
-
-
-/*
- * Switch the debug led on and off.
- */
-void switch_led(void) {
-	static uint8_t led_on = FALSE;
-	if (led_on) {
-		PORTD &= ~(1 << MONITOR_LED);
-		led_on = FALSE;
-	}
-	else {
-		PORTD |= (1 << MONITOR_LED);
-		led_on = TRUE;
-	}
-}
-
-
-
-/*
- * SIGNAL TIMER0_OVF_vect
- * Handles overflow interrupts of timer 0.
- * With prescaler 8 it is calles with 2000 Hz.
- */
-SIGNAL(TIMER0_OVF_vect) {
-	// count ms
-	if (++ms_count == 2000) {
-		clock_tick();
-		ms_count = 0;
-	}
-}
-
-
-
-/*
- * clock_tick
- * Adds a second to the clock.
- */
-void clock_tick(void) {
-	seconds++;
-	if (seconds == 60) {
-		seconds = 0;
-		minutes++;
-		if (minutes == 60) {
-			minutes = 0;
-			hours++;
-			if (hours == 24) {
-				hours = 0;
-				days++;
-			}
-		}
-	}
-}
-
-
-
-/* ---------------------------------
- * menu definition
- */
-#define MAX_MENU_ITEMS 9
-const menu_item menu[] = {
-	{menu_P, 'm', show_menu},
-	{report_P, 'r', show_report},
-	{change_sms_P, 'a', change_sms},
-	{change_pin_P, 'p', change_pin},
-	{switch_on_P, 'o', switch_modem},
-	{init_modem_P, 'i', init_modem},
-	//{network_status_P, 'n', network_status},
-	{send_sms_P, 's', send_position_sms},
-	{cold_gps_P, 'c', cold_gps},
-	{request_gps_P, 'g', request_gps}
-}; 
-
-
-
-/*
- * Displays the menu.
- */
-void show_menu(void) {
-	uint8_t i = 0;
-	
-	printf_P(cr_P);
-	printf_P(cr_P);
-	printf_P(line_P);
-	printf_P(firmware_P); printf_P(cr_P);
-	
-	for (i = 0; i < MAX_MENU_ITEMS; i++) {
-		printf("%c", menu[i].command);
-		printf_P(menu_option_P);
-		printf_P(menu[i].name);
-		printf_P(cr_P); 
-	}
-	printf_P(line_P);
-	printf_P(prompt_P);	
-	
-}
-
-
-
-/*
- * Handles incomming commands.
- * Tries to find a menu entry for the given command char.
- * If a menu was found, the function gets executed.
- */
-uint8_t handle_command(uint8_t command) {
-	uint8_t i = 0;
-
-	printf_P(cr_P);
-	
-	for (i = 0; i < MAX_MENU_ITEMS; i++) {
-		if (command == menu[i].command) {
-			printf_P(menu[i].name);
-			printf_P(cr_P);
-			if (menu[i].work) {
-				menu[i].work();
-			}
-			break;
-		}
-	}
-	if (i == MAX_MENU_ITEMS) {
-		printf_P(error_unknown_command_P, command);
-	}
-	
-	return 0;
-}
-
-
-
-/*
- * Displays all status informations.
- */
-void show_report(void) {
-	char buffer[30];
-	
-	uint16_t mem_reboots = eeprom_read_word(&reboot_counter);
-	printf_P(reboots_P, mem_reboots);
-	
-	printf_P(uptime_P, days, hours, minutes, seconds);	
-	
-	eeprom_read_block(buffer, sms_gateway, 15);
-	printf_P(sms_gateway_P, &buffer);
-
-	eeprom_read_block(buffer, pin, 5);
-	printf_P(pin_P, &buffer);
-	
-	printf_P(modem_state_P, modem_state);
-	
-}
-
-
-
-/*
- * Reads a value from eeprom, reads user input and stores the
- * value back to eeprom.
- */
-void modify_str(char* str) {
-	char buffer[30];
-	uint8_t i;
-	uint16_t c;
-	eeprom_read_block(buffer, str, 15);
-	printf("old value: %s\r\n>", buffer);
-	for (i = 0; i < 15; i++) {
-		while ((c = uart_getc()) == UART_NO_DATA) {}
-		if (c == '\r') {
-			break;
-		}
-		buffer[i] = c;
-	}
-	buffer[i] = 0;
-	eeprom_write_block(buffer, str, 15);
-}
-
-
-
-/*
- * change_sms
- */
-void change_sms(void) {
-	modify_str((char*)sms_gateway);
-}
-
-/*
- * Change the pin.
- */
-void change_pin(void) {
-	modify_str((char*)pin);
-}
-
-
-#define MODE_NONE			0
-#define MODE_SWITCH_MODEM	1
-#define MODE_INIT_MODEM		2
-#define MODE_REQUEST_GPS	3
-#define MODE_SEND_POSITION	4
-#define MODE_WAIT			100
-#define MODE_WAIT2			101
-#define MODE_ERRORED		102
-#define MODE_STOP			103
-
-
-int main(void) {
-	
-	uint8_t i = 0;
-	uint16_t command = 0;
-	uint8_t mode = MODE_NONE;
-	uint8_t next_mode = MODE_NONE;
-	uint8_t wakeup_seconds = 0;
-	uint8_t wakeup_minutes = 0;
-
-	// timer 0 setup, prescaler 8
-	TCCR0 |= (1 << CS11);
-	// enable timer 0 interrupt
-	TIMSK |= (1 << TOIE0);	
-	
-
-	// enable monitor led
-	DDRD |= (1 << MONITOR_LED);
-	
-	// enable on/off switch
-	DDRC |= (1 << MODEM_ON_SWITCH);
-	PORTC &= ~(1 << MODEM_ON_SWITCH);
-
-	// say hello
-	for (i = 0; i < 10; i++) {
-		switch_led();
-		_delay_ms(100);
-	}
-	for (i = 0; i < 200; i++) {
-		_delay_ms(100);
-	}
-	switch_led();
-	
-	inc_reboot_counter();
-	init_uart();	
-	init_suart();
-	sei();
-	
-	stdout = stdin = &uart_file;
-		
-	while (TRUE) {
-		
-		switch (mode) {
-			case MODE_NONE:
-				show_menu();
-				mode = MODE_SWITCH_MODEM;
-				break;
-			case MODE_SWITCH_MODEM:
-				printf_P(switch_on_P); printf_P(cr_P);
-				switch_modem();
-				//mode = MODE_WAIT;
-				mode = MODE_STOP;
-				next_mode = MODE_INIT_MODEM;
-				wakeup_seconds = (seconds + 10) % 60;
-				break;
-			case MODE_INIT_MODEM:
-				printf_P(init_modem_P); printf_P(cr_P);
-				init_modem();
-				if (modem_state == MODEM_ERRORED) {
-					next_mode = MODE_ERRORED;
-				}
-				else {
-					next_mode = MODE_REQUEST_GPS;
-				}
-				mode = MODE_WAIT;
-				wakeup_seconds = (seconds + 15) % 60;
-				break;
-			case MODE_REQUEST_GPS:
-				request_gps();
-				if (modem_state == MODEM_POS_FIX) {
-					mode = MODE_SEND_POSITION;
-				}
-				else {
-					mode = MODE_WAIT;
-					next_mode = MODE_REQUEST_GPS;
-					wakeup_seconds = (seconds + 15) % 60;				
-				}
-				break;
-			case MODE_SEND_POSITION:
-				send_position_sms();
-				wakeup_seconds = seconds;
-				wakeup_minutes = (minutes + 2) % 60;
-				mode = MODE_WAIT2;
-				next_mode = MODE_REQUEST_GPS;
-				break;
-			case MODE_WAIT:
-				if (seconds == wakeup_seconds) {
-					mode = next_mode;
-				}
-				break;
-			case MODE_WAIT2:
-				if ((seconds == wakeup_seconds) && (minutes == wakeup_minutes)) {
-					mode = next_mode;
-				}
-				break;
-			case MODE_ERRORED:
-				printf_P(error_P);
-				mode = MODE_SWITCH_MODEM;				
-				break;
-			case MODE_STOP:
-				break;
-			default:
-				break;
-		}
-	
-		
-		command = suart_getc_nowait();
-		switch (command) {
-			case -1:
-			case '\r':
-			case '\n':
-				break;
-			case '1':
-				if (mode == MODE_WAIT) {
-					mode = MODE_STOP;
-				}
-				else {
-					next_mode = mode;
-					mode = MODE_STOP;
-				}
-				printf_P(interactive_P);
-				break;
-			case '2':
-				mode = next_mode;
-				next_mode = MODE_NONE;
-				printf_P(run_P);
-				break; 
-			default:
-				handle_command(command);
-				break;
-		}
-		
-	}
-	
-	return 0;
-	
-}
+/* ----------------------------------------------------
+ * File    : beacon.c
+ * Title   : GSM-GPS tracking thing
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Disclaimer:
+ * This software comes "as is". Without any warranty.
+ * 
+ * License:
+ * This is published under the Creative Commons License Attribution-NonCommercial.
+ * You are free to distribute and adapt for non-commercial use.
+ * See http://creativecommons.org/licenses/by-nc/3.0/ for more details.
+ *  
+ * History:
+ * 2007/07/12	GPS position received from the GM862. Not parsed.
+ * 2007/07/28	First SMS with link to google maps sent.
+ * 2007/08/08	Sending SMS with positions every 2 minutes
+ * 
+ * 
+ * Known issues:
+ * - There is still a bug in the UART routines. Sending may hang with 
+ *   large messages. The watchdog resets the controller in that case,
+ *   and it resumes in the mode it was in.
+ * 
+ * Notes:
+ * - Search for EDIT THIS in config.c to find the defaults that you need
+ *   to adapt to your setting (PIN and SMS number). Both can also be
+ *   changed with the menu, they are stored in EEPROM.
+ * 
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h> 
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <util/delay.h>
+#include <util/crc16.h>
+#include "uart.h"
+#include "suart.h"
+#include "eeq.h"
+#include "config.h"
+#include "timer.h"
+#include "idle.h"
+#include "rtc.h"
+#include "poslog.h"
+#include "proto.h"
+#include "sms.h"
+#include "aterr.h"
+#include "gps.h"
+#include "profile.h"
+#include "geofence.h"
+#include "cell.h"
+#include "coverage.h"
+#include "capture.h"
+#include "pool.h"
+#include "ram.h"
+#include "bench.h"
+#include "acquire.h"
+#include "remote.h"
+#include "filter.h"
+
+#define TRUE 1
+#define FALSE 0
+
+#define MONITOR_LED PD4
+#define MODEM_ON_SWITCH PC5
+
+
+// setup a file for printf usage
+FILE uart_file = FDEV_SETUP_STREAM(suart_putc_f, suart_getc_f, _FDEV_SETUP_RW);
+// and one for formatted modem commands
+FILE modem_file = FDEV_SETUP_STREAM(uart_putc_f, uart_getc_f, _FDEV_SETUP_RW);
+
+
+// types
+typedef struct {
+	const char *name;
+	unsigned char command;
+	void (*work)(void);
+} menu_item;
+
+typedef struct {
+	const char *command;
+	const char *arg;
+} modem_command;
+
+// answer to PROTO_STATUS
+typedef struct {
+	uint8_t version;
+	uint16_t reboots;
+	uint32_t uptime;
+	uint32_t utc;
+	uint8_t mode;
+	uint8_t modem_state;
+	uint8_t duty;
+	uint8_t log_count;
+	gps_position position;
+} status_record;
+
+// survives a watchdog reset, see save_resume()
+typedef struct {
+	uint8_t mode;
+	uint8_t next_mode;
+	uint8_t modem_state;
+	uint8_t uart_rate;
+	gps_position position;
+	uint8_t crc;
+} resume_state;
+
+
+// EEPROM storage
+uint16_t reboot_counter EEMEM = 0;
+uint16_t reset_counter[4] EEMEM;	// power on, external, brown out, watchdog
+
+// statics
+
+#define MODEM_OFF			0
+#define MODEM_STARTING		1
+#define MODEM_ON			2
+#define MODEM_SHUTTING_DOWN	3
+#define MODEM_INITIALIZED	4
+#define MODEM_POS_FIX		5
+#define MODEM_ERRORED		6
+
+static volatile uint8_t modem_state = 0;
+
+static uint16_t reboots = 0;
+static uint16_t resets[4];
+
+static uint8_t mode = 0;
+static uint8_t next_mode = 0;
+
+static resume_state resume __attribute__ ((section (".noinit")));
+
+static volatile uint8_t report_due = FALSE;
+
+// final result code of the last modem response
+#define RESULT_NONE		0
+#define RESULT_OK		1
+#define RESULT_ERROR	2
+static uint8_t modem_result = RESULT_NONE;
+
+// commands with retry, the first ones are the initialization sequence
+#define AT_CMD_AT		0
+#define AT_CMD_SETUP	1
+#define AT_CMD_CPIN		2
+#define AT_CMD_CMGF		3
+#define AT_CMD_GPSACP	4
+#define AT_CMD_CMGS		5		// the whole SMS, prompt, body and result
+#define AT_CMD_CSQ		6
+#define AT_CMD_MONI		7		// AT#MONI=7 and AT#MONI
+#define AT_CMDS			8
+#define AT_INIT_CMDS	3
+static uint8_t at_retries[AT_CMDS];
+static uint8_t at_failures[AT_CMDS];
+
+// settings the modem is known to have, commands for them are skipped.
+// Cleared when the modem is switched or does not answer, it may have
+// restarted with its defaults.
+#define SESSION_SETUP	0x01		// baud rate and error format
+#define SESSION_TEXT	0x02		// sms text mode
+#define SESSION_PDU		0x04		// sms pdu mode
+static uint8_t modem_session = 0;
+static uint16_t session_saved = 0;	// commands skipped
+
+// baud rate negotiation, the modem is asked to switch with AT+IPR,
+// then the new rate must pass a few AT round trips
+#define BAUD_PROBES		3
+#define BAUD_SETTLE		100			// ms until the modem has switched
+static char rate_arg[7] = "19200";		// the current rate for AT+IPR
+static uint16_t baud_fallbacks = 0;
+
+// escalation, re-init the modem before it is power cycled
+#define MODEM_REINITS	2
+static uint8_t modem_reinit = 0;
+static uint16_t modem_reinits = 0;
+static uint16_t modem_power_cycles = 0;
+
+// time without fix, for the cell fallback, until a fix is taken
+static uint8_t nofix_active = FALSE;
+
+// result of the last GPS poll, see acquire.h
+static uint8_t gps_sats = 0;
+static uint8_t gps_hdop_tenths = 0;
+static uint16_t gps_ms = 0;			// of the utc, for the clock
+static uint16_t gps_wait = ACQUIRE_FAST;
+static uint8_t gps_held = FALSE;	// a fix waits for a better one
+static filter_state gps_filter;
+static uint32_t nofix_start = 0;
+static uint16_t cell_stats[2];		// reported, no cell found
+
+// reports wait for a good signal
+#define COVERAGE_PERIOD	60000		// sample while waiting for reports
+#define COVERAGE_RETRY	10000		// check again while deferring
+#define INBOX_DEFER		COVERAGE_PERIOD	// no text mode just before a PDU report
+static volatile uint8_t coverage_due = FALSE;
+static volatile uint8_t inbox_due = FALSE;	// with the coverage, or on +CMTI
+static uint8_t defer_active = FALSE;
+static uint32_t defer_start = 0;
+static uint16_t defer_count = 0;
+static uint16_t defer_expired = 0;
+
+// sms statistics
+#define SMS_PROMPT_TIMEOUT	5000
+#define SMS_RESULT_TIMEOUT	30000
+static uint32_t sms_start = 0;
+static uint8_t sms_reference = 0;
+static uint8_t sms_concat_ref = 0;
+static uint16_t sms_sent = 0;
+static uint16_t sms_failed = 0;
+static uint32_t sms_latency_sum = 0;
+static uint32_t sms_latency_max = 0;
+
+// current gps position
+static volatile gps_position act_gps_position;
+
+// strings
+const char cr_P[] PROGMEM = "\n";
+const char line_P[] PROGMEM = "------\n";
+const char firmware_P[] PROGMEM = "Beacon v0.03 2007/08/06";
+const char menu_option_P[] PROGMEM = " - ";
+const char prompt_P[] PROGMEM = "key>";
+const char error_unknown_command_P[] PROGMEM = "unknown key: %c\n";
+const char got_P[] PROGMEM = "got: %s\n";
+const char cell_head_P[] PROGMEM = "alex@tinkerlog.com CELL %u-%u";
+const char cell_P[] PROGMEM = " %X:%X %ddBm";
+const char pool_P[] PROGMEM = "buffers %d of %d, %u misses\n";
+const char ram_P[] PROGMEM = "ram: %u static, %u stack never used\n";
+const char no_cell_P[] PROGMEM = "no cell\n";
+const char coverage_P[] PROGMEM = "csq %d, registered %d, %u samples, %u deferred, %u sent anyway\n";
+const char coverage_stat_P[] PROGMEM = "csq %d..: %u sent, %u failed, %lu ms avg\n";
+const char deferred_P[] PROGMEM = "weak signal, report deferred\n";
+const char cell_stats_P[] PROGMEM = "cell: %u reported, %u not found\n";
+const char google_maps_P[] PROGMEM = "alex@tinkerlog.com http://maps.google.com/maps?q=%d.%06lu,%d.%06lu%%28Alex%%20%s%%29&t=k&z=16";
+const char position_P[] PROGMEM = "%d.%06lu %d.%06lu %li %s\n";
+const char time_P[] PROGMEM = "20%02d-%02d-%02dT%02d:%02d:%02dZ";
+const char ok_P[] PROGMEM = " --> OK\n";
+const char no_response_P[] PROGMEM = " --> NO RESPONSE\n";
+const char no_fix_P[] PROGMEM = "no fix\n";
+const char rejected_P[] PROGMEM = "fix rejected (%d)\n";
+const char filter_P[] PROGMEM = "filter: %u ok, %u stale, %u sats, %u hdop, %u jumps\n";
+const char remote_P[] PROGMEM = "sms from %s: %s\n";
+const char remote_stats_P[] PROGMEM = "remote: %u commands, %u rejected\n";
+const char wait_fix_P[] PROGMEM = "fix %c, %d sats, next poll in %u ms\n";
+const char acquire_P[] PROGMEM = "gps: %u fixes, %lu polls, %lu ms avg, %lu ms max to fix\n";
+const char error_P[] PROGMEM = "ERROR\n";
+const char no_prompt_P[] PROGMEM = "no prompt\n";
+const char sms_sent_P[] PROGMEM = "sent, mr %d, %lu ms\n";
+const char sms_failed_P[] PROGMEM = "failed, %lu ms: %s\n";
+const char sms_stats_P[] PROGMEM = "sms: %u sent, %u failed, %lu ms avg, %lu ms max\n";
+const char too_long_P[] PROGMEM = "message too long\n";
+const char interactive_P[] PROGMEM = "INTERACTIVE\n";
+const char run_P[] PROGMEM = "RUN\n";
+const char wait_P[] PROGMEM = "waiting ...\n";
+// menu strings
+const char report_P[] PROGMEM = "Report status";
+const char modem_state_P[] PROGMEM = "Modem %d\n";
+const char change_sms_P[] PROGMEM = "Change sms phone number";
+const char menu_P[] PROGMEM = "Menu"; 
+const char change_pin_P[] PROGMEM = "Change pin";
+const char change_interval_P[] PROGMEM = "Change report interval";
+const char switch_on_P[] PROGMEM = "Switch modem on/off";
+const char init_modem_P[] PROGMEM = "Init modem";
+const char send_sms_P[] PROGMEM = "Send SMS";
+const char cold_gps_P[] PROGMEM = "Cold start GPS";
+const char request_gps_P[] PROGMEM = "Request GPS";
+const char zones_P[] PROGMEM = "Geofence zones";
+const char zone_circle_P[] PROGMEM = "%d: circle %ld %ld r %u m\n";
+const char zone_polygon_P[] PROGMEM = "%d: polygon %ld %ld, %d vertices\n";
+const char zone_state_P[] PROGMEM = "inside: %02x, %lu cycles, %lu us per check of %d zones\n";
+const char zone_event_P[] PROGMEM = "alex@tinkerlog.com %S zone %d %d.%06lu,%d.%06lu %s";
+const char enter_P[] PROGMEM = "enter";
+const char leave_P[] PROGMEM = "leave";
+const char bench_P[] PROGMEM = "Benchmark";
+const char bench_line_P[] PROGMEM = "%S: %lu cycles, %lu us\n";
+const char bench_gps_P[] PROGMEM = "parse $GPSACP";
+const char bench_format_P[] PROGMEM = "format sms";
+const char bench_pack_P[] PROGMEM = "pack 7 bit, per char";
+const char bench_uart_P[] PROGMEM = "modem uart, per char";
+const char bench_ee_read_P[] PROGMEM = "eeprom read word";
+const char bench_ee_write_P[] PROGMEM = "eeprom write word";
+const char bench_filter_P[] PROGMEM = "filter, per fix";
+const char bench_response_P[] PROGMEM = 
+	"$GPSACP: 120631.999,5433.9472N,00954.8768E,1.0,46.5,3,167.28,0.36,0.19,130707,11\r\n";
+#ifdef ISR_PROFILE
+const char profile_P[] PROGMEM = "Interrupt profile";
+const char profile_head_P[] PROGMEM = "isr count lat_min lat_max exec_max [cycles]\n";
+const char profile_line_P[] PROGMEM = "%d %u %u %u %u\n";
+#endif
+const char reboots_P[] PROGMEM = "reboots: %d (por %u, ext %u, bor %u, wdt %u)\n";
+const char resumed_P[] PROGMEM = "resumed mode %d\n";
+const char sms_gateway_P[] PROGMEM = "SMS gateway: %s\n";
+const char pin_P[] PROGMEM = "PIN: %s\n";
+const char interval_P[] PROGMEM = "interval: %u s\n";
+const char interval_range_P[] PROGMEM = "interval: %u..%u s\n";
+const char old_value_P[] PROGMEM = "old value: %s\r\n>";
+const char uptime_P[] PROGMEM = "uptime: %02dD %02d:%02d:%02d\n";
+const char utc_P[] PROGMEM = "utc: %s, drift %ld ppm\n";
+const char wakeups_P[] PROGMEM = "wakeups: timer %lu, uart %lu, suart %lu\n";
+const char duty_P[] PROGMEM = "cpu: %d%%\n";
+const char eeprom_P[] PROGMEM = "eeprom: %u written, %u skipped\n";
+const char uart_dropped_P[] PROGMEM = "modem rx: %u lines dropped\n";
+const char at_stats_P[] PROGMEM = "at %d: %d retries, %d failed\n";
+const char aterr_P[] PROGMEM = "errors: %u timeout, %u transient, %u sim, %u network, %u other\n";
+const char escalation_P[] PROGMEM = "reinit %u, power cycle %u\n";
+const char baud_P[] PROGMEM = "modem %lu baud, %d permille, %u fallbacks\n";
+const char session_P[] PROGMEM = "session %02X, %u commands saved\n";
+const char retry_P[] PROGMEM = "retry in %u ms\n";
+// modem strings
+const char AT_P[] PROGMEM       = "AT";					// say hello
+const char OK_P[] PROGMEM       = "\r\nOK\r\n";			// response
+const char OK_LINE_P[] PROGMEM  = "OK\r";				// final result codes
+const char ERROR_P[] PROGMEM    = "ERROR";
+const char CM_ERROR_P[] PROGMEM = " ERROR";				// +CME ERROR, +CMS ERROR
+const char CMGS_P[] PROGMEM     = "+CMGS: ";			// message reference
+// fixed baud rate, extended errors, +CMTI for new sms
+const char ATSETUP_P[] PROGMEM  = "AT+IPR=%s;+CMEE=2;+CNMI=1,1";
+const char ATIPR_P[] PROGMEM    = "AT+IPR=%s";			// switch baud rate
+const char ATCPIN_P[] PROGMEM   = "AT+CPIN=%s";			// send pin
+const char ATCMGF_P[] PROGMEM   = "AT+CMGF=1";			// sms text mode
+const char ATCMGF0_P[] PROGMEM  = "AT+CMGF=0";			// sms pdu mode
+const char ATCSCS_P[] PROGMEM	= "AT+CSCS?";			// select char set
+const char ATCMGS_P[] PROGMEM   = "AT+CMGS=\"%s\"";		// send sms
+const char ATCMGSPDU_P[] PROGMEM = "AT+CMGS=%s";		// send sms, pdu length
+//const char ATCREG_P[] PROGMEM   = "AT+CREG?";			// network?
+//const char ATGPSR_P[] PROGMEM   = "AT$GPSR=1";		// reset GPS, cold start
+const char ATGPSR_P[] PROGMEM   = "AT$GPSR=2";			// reset GPS, warm start
+const char ATGPSACP_P[] PROGMEM = "AT$GPSACP";			// position request
+const char ATMONI7_P[] PROGMEM  = "AT#MONI=7";			// monitor all cells
+const char ATMONI_P[] PROGMEM   = "AT#MONI";			// cell information
+const char ATCREG2_P[] PROGMEM  = "AT+CREG=2";			// with location info
+const char ATCREGQ_P[] PROGMEM  = "AT+CREG?";			// network?
+const char ATCREG0_P[] PROGMEM  = "AT+CREG=0";
+const char ATCSQ_P[] PROGMEM    = "AT+CSQ";				// signal quality
+const char ATCMGL_P[] PROGMEM   = "AT+CMGL=\"ALL\"";		// list the sms inbox
+const char ATCMGD_P[] PROGMEM   = "AT+CMGD=%s";			// delete an sms
+const char CMTI_P[] PROGMEM     = "+CMTI:";				// new sms
+
+
+// sequence of commands to initialize the modem, the settings are
+// sent in one command line. The PIN is sent alone, as its error is 
+// accepted when the SIM is already unlocked.
+const modem_command MODEM_INIT_SEQ[] = {
+	{AT_P, 0}, {ATSETUP_P, rate_arg}, {ATCPIN_P, config.pin} };
+
+
+// prototypes
+void inc_reboot_counter(uint8_t reset_flags);
+void switch_led(void);
+void show_report(void);
+void show_zones(void);
+void show_bench(void);
+void send_zone_events(void);
+#ifdef ISR_PROFILE
+void show_profile(void);
+#endif
+
+void show_menu(void);
+void change_sms(void);
+void change_pin(void);
+void change_interval(void);
+uint8_t handle_command(uint8_t command);
+
+uint8_t uart_gets_timeout(char *buf, uint8_t size, uint16_t timeout);
+uint8_t final_result(char *line);
+uint8_t modem_backoff(uint8_t id, uint8_t class, uint8_t attempt);
+uint8_t modem_retry(uint8_t id, const char *command, const char *arg, 
+	uint16_t timeout, char *buf, uint8_t size);
+uint8_t modem_failed(void);
+void wait_ms(uint16_t ms);
+uint8_t sms_begin(const char *command, const char *arg);
+uint8_t sms_end(void);
+uint8_t sms_mode(uint8_t mode);
+void switch_modem(void);
+void init_modem(void);
+void set_rate(uint8_t rate);
+uint8_t switch_baud(uint8_t rate, char *buf);
+void negotiate_baud(void);
+void send_sms(const char *number, char *message);
+void send_sms_pdu(const char *number, const char *text, const uint8_t *data, 
+	uint8_t length);
+void send_position_sms(void);
+void send_cell_report(void);
+void sample_coverage(void);
+void coverage_wakeup(void);
+uint8_t send_gate(void);
+uint8_t nofix_expired(void);
+uint8_t request_lines(const char *command, uint16_t timeout, 
+	uint8_t (*handler)(const char *line, void *context), void *context);
+uint8_t lines_retry(uint8_t id, const char *command, uint16_t timeout, 
+	uint8_t (*handler)(const char *line, void *context), void *context);
+void check_inbox(void);
+void network_status(void);
+void cold_gps(void);
+void request_gps(void);
+void parse_gps(char *gps_msg);
+uint8_t check_fix(void);
+void log_position(void);
+void format_time(char *buf, uint32_t utc);
+void schedule_report(void);
+void report_wakeup(void);
+
+
+/*
+ * Increments the reboot counter and the counters of the reset
+ * reasons given in the MCUCSR flags.
+ */
+void inc_reboot_counter(uint8_t reset_flags) {
+	uint8_t i = 0;
+	reboots = eeprom_read_word(&reboot_counter);
+	eeprom_read_block(resets, reset_counter, sizeof(resets));
+	reboots++;
+	eeq_write_word(&reboot_counter, reboots);
+	for (i = 0; i < 4; i++) {
+		if (resets[i] == 0xffff) {
+			resets[i] = 0;		// erased eeprom
+		}
+		if (reset_flags & (1 << i)) {
+			resets[i]++;
+			eeq_write_word(&reset_counter[i], resets[i]);
+		}
+	}
+}
+
+
+
+/*
+ * Stores the current mode, modem state and position in the
+ * noinit section. 
+ */
+void save_resume(void) {
+	uint8_t *p = (uint8_t *)&resume;
+	uint8_t crc = 0;
+	uint8_t i = 0;
+	resume.mode = mode;
+	resume.next_mode = next_mode;
+	resume.modem_state = modem_state;
+	resume.uart_rate = uart_rate;
+	resume.position = act_gps_position;
+	for (i = 0; i < sizeof(resume_state) - 1; i++) {
+		crc = _crc_ibutton_update(crc, *p++);
+	}
+	resume.crc = crc;
+}
+
+
+
+/*
+ * Checks if the snapshot in the noinit section is intact.
+ */
+uint8_t resume_valid(void) {
+	uint8_t *p = (uint8_t *)&resume;
+	uint8_t crc = 0;
+	uint8_t i = 0;
+	for (i = 0; i < sizeof(resume_state); i++) {
+		crc = _crc_ibutton_update(crc, *p++);
+	}
+	return crc == 0;
+}
+
+
+/*
+ * Switches the modem on and off.
+ */
+void switch_modem(void) {
+	uint8_t i = 0;
+
+	PORTC |= (1 << MODEM_ON_SWITCH);
+	for (i = 0; i < 200; i++) {
+		_delay_ms(10);
+		wdt_reset();
+	}
+	PORTC &= ~(1 << MODEM_ON_SWITCH);
+	modem_session = 0;
+	set_rate(UART_RATE_DEFAULT);		// the modem starts with autobauding
+	if (modem_state == MODEM_OFF) {
+		modem_state = MODEM_ON;
+	}
+}
+
+
+
+/*
+ * Sends a request to the modem and stores the response into
+ * the buffer. The command may contain a %s, which is replaced 
+ * by arg.
+ */
+uint8_t request_modem(const char *command, const char *arg, 
+		uint16_t timeout, uint8_t check, char *buf, uint8_t size) {
+			
+	uint8_t count = 0;
+	char *found = 0;
+
+	printf_P(command, arg);
+	
+	fprintf_P(&modem_file, command, arg);
+	uart_putc('\r');
+	count = uart_gets_timeout(buf, size, timeout);
+	if (count) {
+		if (check) {
+			found = strstr_P(buf, OK_P);
+			if (found) {
+				printf_P(ok_P);
+			}
+			else {
+				printf("%d, %s\n", count, buf);  
+				//printf_P(got_P, buf);
+			} 
+		}
+		else {
+			printf("%d, %s\n", count, buf);  
+			//printf_P(cr_P);
+		}
+	}
+	else {
+		printf_P(no_response_P);
+		modem_session = 0;
+	}
+	return count;
+}
+
+
+
+/*
+ * Gets a response from the modem. Returns as soon as a final result
+ * code (OK, ERROR, +CME ERROR, +CMS ERROR) was received, or after
+ * the timeout. The result is kept in modem_result.
+ */
+uint8_t uart_gets_timeout(char *buf, uint8_t size, uint16_t timeout) {
+	uint8_t count = 0;
+	uint8_t n;
+	uint32_t start = timer_millis();
+	char line[12];		// for the result code, if buf is full
+	char *dst;
+	*buf = 0;
+	modem_result = RESULT_NONE;
+	while ((timer_millis() - start) < timeout) {
+		if (count < size - sizeof(line)) {
+			dst = buf + count;
+			n = uart_gets(dst, size - count);
+			count += n;
+		}
+		else {
+			dst = line;
+			n = uart_gets(line, sizeof(line));
+		}
+		if (n == 0) {
+			idle_sleep();
+			wdt_reset();
+		}
+		else {
+			modem_result = final_result(dst);
+			if (modem_result != RESULT_NONE) {
+				break;
+			}
+		}
+	}
+	if (count != 0) {
+		count++;
+	}
+	return count;
+}
+
+
+
+/*
+ * Checks if a response line is a final result code.
+ */
+uint8_t final_result(char *line) {
+	if (strncmp_P(line, OK_LINE_P, 3) == 0) {
+		return RESULT_OK;
+	}
+	if ((strncmp_P(line, ERROR_P, 5) == 0) || 
+			((line[0] == '+') && (strncmp_P(line + 4, CM_ERROR_P, 6) == 0))) {
+		return RESULT_ERROR;
+	}
+	return RESULT_NONE;
+}
+
+
+
+/*
+ * Decides if a failed command is tried again, and waits for the
+ * backoff if so. A command that failed for good with an error that 
+ * is not a plain one, e.g. no answer, marks the modem as errored, 
+ * see modem_failed().
+ * id		index into the command statistics
+ * class	error class of the attempt
+ * attempt	0 for the first try
+ * return	uint8_t	TRUE if the command is to be repeated
+ */
+uint8_t modem_backoff(uint8_t id, uint8_t class, uint8_t attempt) {
+	if (!aterr_retry(class) || (attempt + 1 >= ATERR_RETRIES)) {
+		at_failures[id]++;
+		if (class != ATERR_OTHER) {
+			modem_state = MODEM_ERRORED;
+			// keep the traffic that led to it
+			CAPTURE_FREEZE();
+		}
+		return FALSE;
+	}
+	at_retries[id]++;
+	printf_P(retry_P, aterr_backoff(attempt));
+	wait_ms(aterr_backoff(attempt));
+	// drop late responses to the last try
+	while (uart_getc() != UART_NO_DATA) {
+		;
+	}
+	return TRUE;
+}
+
+
+
+/*
+ * Sends a command to the modem and repeats it with increasing 
+ * backoff as long as the error is one that may go away.
+ * id		index into the command statistics
+ * return	uint8_t	ATERR_NONE if OK was received, the error class else
+ */
+uint8_t modem_retry(uint8_t id, const char *command, const char *arg, 
+		uint16_t timeout, char *buf, uint8_t size) {
+	uint8_t attempt;
+	uint8_t class;
+	for (attempt = 0; ; attempt++) {
+		request_modem(command, arg, timeout, TRUE, buf, size);
+		if (modem_result == RESULT_OK) {
+			return ATERR_NONE;
+		}
+		class = aterr_classify(buf);
+		if (!modem_backoff(id, class, attempt)) {
+			return class;
+		}
+	}
+}
+
+
+
+/*
+ * Waits some ms, sleeping between the ticks.
+ */
+void wait_ms(uint16_t ms) {
+	uint32_t start = timer_millis();
+	while ((timer_millis() - start) < ms) {
+		idle_sleep();
+		wdt_reset();
+	}
+}
+
+
+
+/*
+ * Initializes the modem with an initialization sequence.
+ */
+void init_modem(void) {
+	char *buf = pool_acquire();
+	uint8_t i = 0;
+	uint8_t class;
+	if (!buf) {
+		modem_state = MODEM_ERRORED;
+		return;
+	}
+	for (i = 0; i < AT_INIT_CMDS; i++) {
+		if ((i == AT_CMD_SETUP) && (modem_session & SESSION_SETUP)) {
+			session_saved++;
+			continue;
+		}
+		class = modem_retry(i, MODEM_INIT_SEQ[i].command, MODEM_INIT_SEQ[i].arg, 
+			1000, buf, POOL_BUFFER_SIZE);
+		// plain errors are accepted, e.g. the PIN of an unlocked SIM
+		if ((class != ATERR_NONE) && (class != ATERR_OTHER)) {
+			pool_release(buf);
+			modem_state = MODEM_ERRORED;
+			return;
+		}
+		if (i == AT_CMD_SETUP) {
+			modem_session |= SESSION_SETUP;
+		}
+	}
+	pool_release(buf);
+	modem_state = MODEM_INITIALIZED;
+	acquire_reset();
+	negotiate_baud();
+}
+
+
+
+/*
+ * Sets the uart to a rate, and the rate for AT+IPR.
+ */
+void set_rate(uint8_t rate) {
+	uart_baud(rate);
+	ultoa(uart_rate_baud(uart_rate), rate_arg, 10);
+}
+
+
+
+/*
+ * Switches the modem and the uart to another rate and checks the
+ * link with a few round trips. If they fail, the old rate is 
+ * restored. If that fails too, the modem is lost.
+ * buf		for the responses, POOL_BUFFER_SIZE bytes
+ * return	uint8_t	TRUE if the new rate works
+ */
+uint8_t switch_baud(uint8_t rate, char *buf) {
+	char arg[7];
+	uint8_t old = uart_rate;
+	uint8_t i;
+	if (uart_rate_error(rate) > UART_MAX_ERROR) {
+		return FALSE;
+	}
+	ultoa(uart_rate_baud(rate), arg, 10);
+	request_modem(ATIPR_P, arg, 1000, TRUE, buf, POOL_BUFFER_SIZE);
+	if (modem_result != RESULT_OK) {
+		return FALSE;
+	}
+	set_rate(rate);
+	wait_ms(BAUD_SETTLE);
+	for (i = 0; i < BAUD_PROBES; i++) {
+		request_modem(AT_P, 0, 500, TRUE, buf, POOL_BUFFER_SIZE);
+		if (modem_result != RESULT_OK) {
+			break;
+		}
+	}
+	if (i == BAUD_PROBES) {
+		return TRUE;
+	}
+	// back to the old rate, the command may get through garbled
+	ultoa(uart_rate_baud(old), arg, 10);
+	request_modem(ATIPR_P, arg, 1000, FALSE, buf, POOL_BUFFER_SIZE);
+	set_rate(old);
+	wait_ms(BAUD_SETTLE);
+	while (uart_getc() != UART_NO_DATA) {
+		;
+	}
+	request_modem(AT_P, 0, 1000, TRUE, buf, POOL_BUFFER_SIZE);
+	if (modem_result != RESULT_OK) {
+		modem_state = MODEM_ERRORED;
+	}
+	return FALSE;
+}
+
+
+
+/*
+ * Moves the link to the configured rate. Rates that fail fall back 
+ * towards the current one, the rate that works is saved.
+ */
+void negotiate_baud(void) {
+	char *buf;
+	uint8_t rate = config.modem_rate;
+	if (rate >= UART_RATES) {
+		rate = UART_RATE_DEFAULT;
+	}
+	if (rate != uart_rate) {
+		buf = pool_acquire();
+		if (!buf) {
+			return;
+		}
+		while (rate != uart_rate) {
+			if (switch_baud(rate, buf)) {
+				break;
+			}
+			if (modem_state == MODEM_ERRORED) {
+				pool_release(buf);
+				return;
+			}
+			if (uart_rate_error(rate) <= UART_MAX_ERROR) {
+				baud_fallbacks++;
+			}
+			rate += (rate < uart_rate) ? 1 : -1;
+		}
+		pool_release(buf);
+	}
+	if (config.modem_rate != uart_rate) {
+		config.modem_rate = uart_rate;
+		config_save();
+	}
+}
+
+
+
+/*
+ * Sends the AT+CMGS command and waits for the "> " prompt. The 
+ * message body is written by the caller, then sms_end() is called.
+ * return	uint8_t	ATERR_NONE if the prompt was received, the error
+ *					class else
+ */
+uint8_t sms_begin(const char *command, const char *arg) {
+	char *line = pool_acquire();
+	uint8_t result = RESULT_NONE;
+	uint8_t class;
+	if (!line) {
+		return ATERR_OTHER;
+	}
+	printf_P(command, arg);
+	printf_P(cr_P);
+	sms_start = timer_millis();
+	fprintf_P(&modem_file, command, arg);
+	uart_putc('\r');
+	while ((result == RESULT_NONE) && 
+			((timer_millis() - sms_start) < SMS_PROMPT_TIMEOUT)) {
+		if (uart_gets(line, POOL_BUFFER_SIZE) == 0) {
+			idle_sleep();
+			wdt_reset();
+		}
+		else if ((line[0] == '>') && (line[1] == ' ')) {
+			pool_release(line);
+			return ATERR_NONE;
+		}
+		else {
+			result = final_result(line);
+		}
+	}
+	printf_P(no_prompt_P);
+	uart_putc(0x1b);		// abort
+	modem_session = 0;
+	coverage_sent(FALSE, 0);
+	class = aterr_classify((result == RESULT_NONE) ? 0 : line);
+	pool_release(line);
+	return class;
+}
+
+
+
+/*
+ * Ends the message body and waits for the +CMGS result with the
+ * message reference.
+ * return	uint8_t	ATERR_NONE if the message was accepted, the error
+ *					class else
+ */
+uint8_t sms_end(void) {
+	char *buf = pool_acquire();
+	char *found;
+	uint32_t latency;
+	uint8_t class;
+	uart_putc(0x1a);
+	if (!buf) {
+		return ATERR_OTHER;
+	}
+	uart_gets_timeout(buf, POOL_BUFFER_SIZE, SMS_RESULT_TIMEOUT);
+	latency = timer_millis() - sms_start;
+	found = strstr_P(buf, CMGS_P);
+	if ((modem_result == RESULT_OK) && found) {
+		sms_reference = atoi(found + 7);
+		sms_sent++;
+		sms_latency_sum += latency;
+		if (latency > sms_latency_max) {
+			sms_latency_max = latency;
+		}
+		printf_P(sms_sent_P, sms_reference, latency);
+		coverage_sent(TRUE, latency);
+		pool_release(buf);
+		return ATERR_NONE;
+	}
+	coverage_sent(FALSE, latency);
+	class = aterr_classify(buf);
+	printf_P(sms_failed_P, latency, buf);
+	pool_release(buf);
+	return class;
+}
+
+
+
+/*
+ * Selects the sms text or PDU mode, the command is skipped if the
+ * modem is known to be in that mode.
+ * mode		SESSION_TEXT or SESSION_PDU
+ * return	uint8_t	TRUE if the mode is selected
+ */
+uint8_t sms_mode(uint8_t mode) {
+	char buf[20];
+	if (modem_session & mode) {
+		session_saved++;
+		return TRUE;
+	}
+	modem_session &= ~(SESSION_TEXT | SESSION_PDU);
+	if (modem_retry(AT_CMD_CMGF, (mode == SESSION_TEXT) ? ATCMGF_P : ATCMGF0_P, 0, 
+			1500, buf, sizeof(buf)) != ATERR_NONE) {
+		sms_failed++;
+		return FALSE;
+	}
+	modem_session |= mode;
+	return TRUE;
+}
+
+
+
+/*
+ * Sends an SMS to number. Text mode is used only if it fits into
+ * one SMS, longer messages are sent concatenated in PDU mode.
+ * The whole message is sent again as long as the error may go away.
+ */
+void send_sms(const char *number, char *message) {
+	uint8_t attempt;
+	uint8_t class;
+
+	if ((config.transport != TRANSPORT_SMS_TEXT) || 
+			(sms_septets(message, 255) > SMS_MAX_SEPTETS)) {
+		send_sms_pdu(number, message, 0, 0);
+		return;
+	}
+	if (!sms_mode(SESSION_TEXT)) {
+		return;
+	}
+	for (attempt = 0; ; attempt++) {
+		class = sms_begin(ATCMGS_P, number);
+		if (class == ATERR_NONE) {
+			uart_puts(message);
+			class = sms_end();
+		}
+		if (class == ATERR_NONE) {
+			return;
+		}
+		if (!modem_backoff(AT_CMD_CMGS, class, attempt)) {
+			break;
+		}
+	}
+	sms_failed++;
+}
+
+
+
+/*
+ * Puts an octet as two hex digits to the modem.
+ */
+void modem_put_hex(uint8_t octet) {
+	uint8_t nibble = octet >> 4;
+	uart_putc(nibble + ((nibble < 10) ? '0' : 'A' - 10));
+	nibble = octet & 0x0f;
+	uart_putc(nibble + ((nibble < 10) ? '0' : 'A' - 10));
+}
+
+
+
+/*
+ * Sends an SMS to number in PDU mode. Either text is sent with 7 
+ * bit coding, or, if text is 0, data is sent with 8 bit coding. The 
+ * PDU is encoded while it is sent, there is no PDU buffer.
+ * Text longer than one SMS is sent as concatenated message. Each 
+ * part is sent again as long as the error may go away.
+ */
+void send_sms_pdu(const char *number, const char *text, const uint8_t *data, 
+		uint8_t length) {
+	char tpdu_length[4];
+	uint8_t udl = length;
+	uint8_t ud_octets = length;
+	uint8_t parts = 1;
+	uint8_t part = 0;
+	uint8_t n = 0;
+	uint8_t attempt;
+	uint8_t class;
+	uint8_t i;
+
+	if (text) {
+		if (sms_septets(text, 255) > SMS_MAX_SEPTETS) {
+			parts = sms_parts(text);
+			sms_concat_ref++;
+		}
+	}
+	else if (length > SMS_MAX_OCTETS) {
+		printf_P(too_long_P);
+		return;
+	}
+
+	if (!sms_mode(SESSION_PDU)) {
+		return;
+	}
+	for (part = 1; part <= parts; part++) {
+		if (text) {
+			n = sms_fit(text, (parts > 1) ? SMS_PART_SEPTETS : SMS_MAX_SEPTETS);
+			udl = sms_septets(text, n);
+			if (parts > 1) {
+				udl += SMS_UDH_SEPTETS;
+			}
+			ud_octets = (udl * 7 + 7) / 8;
+		}
+		utoa(sms_tpdu_length(number, ud_octets), tpdu_length, 10);
+		for (attempt = 0; ; attempt++) {
+			class = sms_begin(ATCMGSPDU_P, tpdu_length);
+			if (class == ATERR_NONE) {
+				sms_header(modem_put_hex, config.smsc, number, 
+					text ? SMS_DCS_7BIT : SMS_DCS_8BIT, udl, parts > 1);
+				if (text) {
+					if (parts > 1) {
+						sms_udh(modem_put_hex, sms_concat_ref, parts, part);
+					}
+					sms_pack7(modem_put_hex, text, n, (parts > 1) ? 1 : 0);
+				}
+				else {
+					for (i = 0; i < length; i++) {
+						modem_put_hex(data[i]);
+					}
+				}
+				class = sms_end();
+			}
+			if (class == ATERR_NONE) {
+				break;
+			}
+			if (!modem_backoff(AT_CMD_CMGS, class, attempt)) {
+				sms_failed++;
+				return;
+			}
+		}
+		if (text) {
+			text += n;
+		}
+	}
+}
+
+
+
+/*
+ * Sends a command and passes each line of the response to the
+ * handler, for responses that don't fit into one buffer.
+ * return	uint8_t	ATERR_NONE if the response ended with OK, the
+ *					error class else
+ */
+uint8_t request_lines(const char *command, uint16_t timeout, 
+		uint8_t (*handler)(const char *line, void *context), void *context) {
+	char *line = pool_acquire();
+	uint32_t start = timer_millis();
+	uint8_t class;
+	if (!line) {
+		return ATERR_OTHER;
+	}
+	printf_P(command);
+	printf_P(cr_P);
+	uart_puts_P(command);
+	uart_putc('\r');
+	modem_result = RESULT_NONE;
+	while ((timer_millis() - start) < timeout) {
+		if (uart_gets(line, POOL_BUFFER_SIZE) == 0) {
+			idle_sleep();
+			wdt_reset();
+			continue;
+		}
+		modem_result = final_result(line);
+		if (modem_result != RESULT_NONE) {
+			break;
+		}
+		if (handler) {
+			handler(line, context);
+		}
+	}
+	if (modem_result == RESULT_NONE) {
+		modem_session = 0;		// no answer
+	}
+	class = (modem_result == RESULT_OK) ? ATERR_NONE : 
+		aterr_classify((modem_result == RESULT_NONE) ? 0 : line);
+	pool_release(line);
+	return class;
+}
+
+
+
+/*
+ * request_lines() with the retries of modem_retry().
+ * return	uint8_t	ATERR_NONE if the response ended with OK, the
+ *					error class else
+ */
+uint8_t lines_retry(uint8_t id, const char *command, uint16_t timeout, 
+		uint8_t (*handler)(const char *line, void *context), void *context) {
+	uint8_t attempt;
+	uint8_t class;
+	for (attempt = 0; ; attempt++) {
+		class = request_lines(command, timeout, handler, context);
+		if ((class == ATERR_NONE) || !modem_backoff(id, class, attempt)) {
+			return class;
+		}
+	}
+}
+
+
+
+/*
+ * Samples the signal quality and the network registration.
+ */
+void sample_coverage(void) {
+	char *buf = pool_acquire();
+	if (!buf) {
+		return;
+	}
+	if ((modem_retry(AT_CMD_CSQ, ATCSQ_P, 0, 1000, buf, POOL_BUFFER_SIZE) != ATERR_NONE) ||
+			!coverage_parse_csq(buf)) {
+		coverage_csq = COVERAGE_UNKNOWN;
+	}
+	request_modem(ATCREGQ_P, 0, 1000, TRUE, buf, POOL_BUFFER_SIZE);
+	if (!coverage_parse_creg(buf)) {
+		coverage_registered = FALSE;
+	}
+	pool_release(buf);
+}
+
+
+
+/*
+ * Timer callback, samples the signal in the main loop.
+ */
+void coverage_wakeup(void) {
+	coverage_due = TRUE;
+	inbox_due = TRUE;
+}
+
+
+
+/*
+ * Decides if a report is sent now. With weak signal or without 
+ * network, it is held back until the signal gets better, but not
+ * longer than config.max_defer.
+ * return	uint8_t	TRUE if the report should be sent
+ */
+uint8_t send_gate(void) {
+	if (config.min_csq == 0) {
+		return TRUE;
+	}
+	sample_coverage();
+	if (coverage_good(config.min_csq)) {
+		defer_active = FALSE;
+		return TRUE;
+	}
+	if (!defer_active) {
+		defer_active = TRUE;
+		defer_start = timer_millis();
+		defer_count++;
+	}
+	if ((timer_millis() - defer_start) >= config.max_defer * 1000UL) {
+		defer_active = FALSE;
+		defer_expired++;
+		return TRUE;
+	}
+	printf_P(deferred_P);
+	return FALSE;
+}
+
+
+
+/*
+ * Checks if the GPS had no fix for longer than the configured 
+ * timeout. Only used for periodic reports, zones need a fix. Once
+ * expired, it stays expired until a fix is taken, so each report
+ * is a cell report until then.
+ */
+uint8_t nofix_expired(void) {
+	if (!nofix_active) {
+		nofix_active = TRUE;
+		nofix_start = timer_millis();
+	}
+	return (config.nofix_timeout != 0) && 
+		(config.report_mode == REPORT_PERIODIC) &&
+		((timer_millis() - nofix_start) >= config.nofix_timeout * 1000UL);
+}
+
+
+
+/*
+ * Line handlers for request_lines().
+ */
+uint8_t moni_line(const char *line, void *report) {
+	return cell_parse_moni(line, (cell_report *)report);
+}
+
+uint8_t creg_line(const char *line, void *report) {
+	return cell_parse_creg(line, (cell_report *)report);
+}
+
+
+
+/*
+ * Carries out the commands in the SMS inbox. Each message is deleted
+ * after it was read, so the first one listed is the next to do.
+ * Nothing is done without a master number. A new report interval
+ * restarts the report timer, a report already due stays due.
+ * The inbox is listed in text mode. In PDU mode the poll waits when
+ * the next report comes within INBOX_DEFER, it is checked after the
+ * report, so AT+CMGF changes at most twice per report.
+ * A value that is not taken is answered to the sender. Two pool 
+ * buffers at most: the message, and the line of sms_begin() while 
+ * the answer is sent.
+ */
+#define INBOX_MAX 4
+typedef char remote_message_fits[(sizeof(remote_message) <= POOL_BUFFER_SIZE) ? 1 : -1];
+void check_inbox(void) {
+	remote_message *msg;
+	char *buf;
+	char index[4];
+	uint16_t interval;
+	uint8_t result;
+	uint8_t due;
+	uint8_t i;
+	if (config.master[0] == 0) {
+		return;
+	}
+	if ((modem_session & SESSION_PDU) && 
+			(report_due || (timer_active(TIMER_REPORT) && 
+			(timer_remaining(TIMER_REPORT) < INBOX_DEFER)))) {
+		return;
+	}
+	msg = (remote_message *)pool_acquire();
+	if (!msg) {
+		return;
+	}
+	for (i = 0; i < INBOX_MAX; i++) {
+		// a reply in PDU mode switched it
+		if (!sms_mode(SESSION_TEXT)) {
+			break;
+		}
+		remote_clear(msg);
+		request_lines(ATCMGL_P, 5000, remote_parse_line, msg);
+		if (msg->lines == 0) {
+			break;
+		}
+		printf_P(remote_P, msg->sender, msg->text);
+		interval = config.report_interval;
+		result = remote_command(msg);
+		switch (result) {
+			case REMOTE_WHERE:
+				report_due = TRUE;
+				break;
+			case REMOTE_SET:
+				if (config.report_interval != interval) {
+					due = report_due;
+					timer_stop(TIMER_REPORT);
+					schedule_report();
+					if (due) {
+						report_due = TRUE;
+					}
+				}
+				break;
+		}
+		utoa(msg->index, index, 10);
+		buf = pool_acquire();
+		if (!buf) {
+			break;
+		}
+		request_modem(ATCMGD_P, index, 2000, TRUE, buf, POOL_BUFFER_SIZE);
+		pool_release(buf);
+		if (modem_result != RESULT_OK) {
+			break;		// don't do it again
+		}
+		if (result == REMOTE_INVALID) {
+			send_sms(msg->sender, msg->reply);
+		}
+	}
+	pool_release(msg);
+}
+
+
+
+/*
+ * Reports the serving and neighbour cells instead of a position,
+ * as text flagged with CELL, or binary with its own batch version:
+ * BATCH_CELL, then the encoded cell report, see cell.h.
+ */
+#define BATCH_CELL 2
+void send_cell_report(void) {
+	char *buf;
+	cell_report report;
+	uint8_t i;
+	uint8_t n;
+	cell_clear(&report);
+	if (lines_retry(AT_CMD_MONI, ATMONI7_P, 1000, 0, 0) == ATERR_NONE) {
+		lines_retry(AT_CMD_MONI, ATMONI_P, 5000, moni_line, &report);
+	}
+	if (modem_state == MODEM_ERRORED) {
+		return;
+	}
+	if (report.count == 0) {
+		request_lines(ATCREG2_P, 1000, 0, 0);
+		request_lines(ATCREGQ_P, 1000, creg_line, &report);
+		request_lines(ATCREG0_P, 1000, 0, 0);
+	}
+	cell_stats[(report.count != 0) ? 0 : 1]++;
+	if (report.count == 0) {
+		printf_P(no_cell_P);
+		return;
+	}
+	buf = pool_acquire();
+	if (!buf) {
+		return;
+	}
+	if (config.transport == TRANSPORT_SMS_BINARY) {
+		buf[0] = BATCH_CELL;
+		send_sms_pdu(config.sms_gateway, 0, (uint8_t *)buf, 
+			1 + cell_encode(&report, (uint8_t *)buf + 1));
+	}
+	else {
+		n = sprintf_P(buf, cell_head_P, report.mcc, report.mnc);
+		for (i = 0; i < report.count; i++) {
+			n += sprintf_P(buf + n, cell_P, 
+				report.cell[i].lac, report.cell[i].ci, report.cell[i].dbm);
+		}
+		send_sms(config.sms_gateway, buf);
+	}
+	pool_release(buf);
+}
+
+
+
+/*
+ * Builds a binary batch of the newest logged positions:
+ * version, count, then per position utc (4), lat deg (1), 
+ * lat min (3), lon deg (1), lon min (3), little endian.
+ * return	uint8_t	length of the batch
+ */
+#define BATCH_VERSION 1
+#define BATCH_RECORD 12
+uint8_t build_batch(uint8_t *buf) {
+	poslog_record record;
+	uint8_t count = poslog_count();
+	uint8_t n = (SMS_MAX_OCTETS - 2) / BATCH_RECORD;
+	uint8_t *p = buf + 2;
+	if (n > count) {
+		n = count;
+	}
+	buf[0] = BATCH_VERSION;
+	buf[1] = n;
+	while (n--) {
+		poslog_read(count - n - 1, &record);
+		memcpy(p, &record.utc, 4);
+		p[4] = record.lat_deg;
+		memcpy(p + 5, &record.lat_min, 3);
+		p[8] = record.lon_deg;
+		memcpy(p + 9, &record.lon_min, 3);
+		p += BATCH_RECORD;
+	}
+	return p - buf;
+}
+
+
+
+/*
+ * Sends the current position via SMS if it is a valid (fix) 
+ * position.
+ */
+void send_position_sms(void) {
+	
+	char *buf;
+	char time[21];
+	if (act_gps_position.fix > 0) {
+		buf = pool_acquire();
+		if (!buf) {
+			return;
+		}
+		if (config.transport == TRANSPORT_SMS_BINARY) {
+			send_sms_pdu(config.sms_gateway, 0, (uint8_t *)buf, 
+				build_batch((uint8_t *)buf));
+		}
+		else {
+			format_time(time, act_gps_position.utc);
+			sprintf_P(buf, google_maps_P,  
+				act_gps_position.lat_deg, act_gps_position.lat_min,
+				act_gps_position.lon_deg, act_gps_position.lon_min,
+				time
+			);
+			send_sms(config.sms_gateway, buf);
+		}
+		pool_release(buf);
+	}
+	
+	//send_sms("alex@tinkerlog.com dies ist ein test und der geht uber eine ganze menge zeichen");	
+}
+
+/*
+ * Position in microdegrees, for the geofence.
+ */
+int32_t to_udeg(uint8_t degree, uint32_t millionths) {
+	return degree * 1000000L + millionths;
+}
+
+
+
+/*
+ * Sends an SMS for each zone entered or left since the last fix.
+ */
+void send_zone_events(void) {
+	char *buf;
+	char time[21];
+	uint8_t entered;
+	uint8_t left;
+	uint8_t i;
+	if (act_gps_position.fix == 0) {
+		return;
+	}
+	geofence_update(
+		to_udeg(act_gps_position.lat_deg, act_gps_position.lat_min), 
+		to_udeg(act_gps_position.lon_deg, act_gps_position.lon_min), 
+		&entered, &left);
+	if (!(entered | left)) {
+		return;
+	}
+	buf = pool_acquire();
+	if (!buf) {
+		return;
+	}
+	format_time(time, act_gps_position.utc);
+	for (i = 0; i < GEOFENCE_ZONES; i++) {
+		if ((entered | left) & (1 << i)) {
+			sprintf_P(buf, zone_event_P, (entered & (1 << i)) ? enter_P : leave_P, 
+				i, act_gps_position.lat_deg, act_gps_position.lat_min,
+				act_gps_position.lon_deg, act_gps_position.lon_min, time);
+			send_sms(config.sms_gateway, buf);
+		}
+	}
+	pool_release(buf);
+}
+
+/*
+void network_status(void) {
+	char buf[100];
+	request_modem(ATCREG_P, 0, 1000, FALSE, buf, sizeof(buf));
+	printf_P(got_P, buf);			
+}
+*/
+
+
+
+/*
+ * Starts the GPS over, the last fix is forgotten.
+ */
+void cold_gps(void) {
+	char *buf = pool_acquire();
+	if (!buf) {
+		return;
+	}
+	request_modem(ATGPSR_P, 0, 2000, TRUE, buf, POOL_BUFFER_SIZE);
+	printf_P(got_P, buf);			
+	acquire_reset();
+	filter_reset(&gps_filter);
+	pool_release(buf);
+}
+
+
+
+/*
+ * Request the GPS position. 
+ * Position is parsed and converted and stored globally. The poll
+ * policy decides if it is taken and when to poll next. Only a fix
+ * it would take is checked with the filter, a fix held back for a
+ * better one is not. A fix that is taken also sets the clock.
+ */
+void request_gps(void) {
+	char *buf = pool_acquire();
+	char time[21];
+	uint32_t now;
+	uint8_t fix;
+	gps_held = FALSE;
+	if (!buf) {
+		act_gps_position.fix = 0;
+		return;
+	}
+	act_gps_position.fix = 0;	// invalidate actual position			
+	modem_retry(AT_CMD_GPSACP, ATGPSACP_P, 0, 4000, buf, POOL_BUFFER_SIZE);
+	if (modem_state == MODEM_ERRORED) {
+		pool_release(buf);
+		return;
+	}
+	printf_P(got_P, buf);
+	gps_sats = 0;
+	if (strlen(buf) > 29) {
+		parse_gps(buf);
+	}
+	now = timer_millis();
+	fix = act_gps_position.fix ? act_gps_position.fix - '0' : 0;
+	if (acquire_ready(fix, config.min_fix, config.fix_budget, now) && 
+			(check_fix() != FILTER_OK)) {
+		act_gps_position.fix = 0;
+		fix = 0;
+	}
+	gps_wait = acquire_poll(fix, gps_sats, config.min_fix, config.fix_budget, now);
+	if (gps_wait != 0) {
+		if (act_gps_position.fix > 0) {
+			printf_P(wait_fix_P, act_gps_position.fix, gps_sats, gps_wait);
+			act_gps_position.fix = 0;	// waiting for a better one
+			gps_held = TRUE;
+			nofix_active = FALSE;		// it is a fix, no cell report
+		}
+		else {
+			printf_P(no_fix_P);
+		}
+		modem_state = MODEM_INITIALIZED;
+	}
+	else {
+		format_time(time, act_gps_position.utc);
+		printf_P(position_P,  
+			act_gps_position.lat_deg, act_gps_position.lat_min,
+			act_gps_position.lon_deg, act_gps_position.lon_min, 
+			act_gps_position.alt, time);
+		modem_state = MODEM_POS_FIX;
+		// only fixes that passed the filter set the clock
+		if (act_gps_position.utc != 0) {
+			rtc_sync(act_gps_position.utc, gps_ms);
+		}
+		log_position();
+	}
+	pool_release(buf);
+}
+
+
+
+/*
+ * Checks the actual position with the plausibility filter, it may
+ * be smoothed.
+ * return	uint8_t	FILTER_OK or the reason of the rejection
+ */
+uint8_t check_fix(void) {
+	filter_fix fix;
+	uint8_t result;
+	fix.lat = to_udeg(act_gps_position.lat_deg, act_gps_position.lat_min);
+	fix.lon = to_udeg(act_gps_position.lon_deg, act_gps_position.lon_min);
+	fix.utc = act_gps_position.utc;
+	fix.time = timer_uptime();
+	fix.hdop = gps_hdop_tenths;
+	fix.sats = gps_sats;
+	result = filter_check(&gps_filter, &fix);
+	if (result != FILTER_OK) {
+		printf_P(rejected_P, result);
+		return result;
+	}
+	act_gps_position.lat_deg = fix.lat / 1000000L;
+	act_gps_position.lat_min = fix.lat % 1000000L;
+	act_gps_position.lon_deg = fix.lon / 1000000L;
+	act_gps_position.lon_min = fix.lon % 1000000L;
+	return result;
+}
+
+
+
+/*
+ * Appends the current position to the position log.
+ */
+void log_position(void) {
+	poslog_record record;
+	record.utc = act_gps_position.utc;
+	record.lat_deg = act_gps_position.lat_deg;
+	record.lat_min = act_gps_position.lat_min;
+	record.lon_deg = act_gps_position.lon_deg;
+	record.lon_min = act_gps_position.lon_min;
+	record.alt = act_gps_position.alt;
+	poslog_add(&record);
+}
+
+
+
+/*
+ * Formats a time as ISO 8601, "2007-07-13T12:06:31Z".
+ * The buffer must hold 21 chars.
+ */
+void format_time(char *buf, uint32_t utc) {
+	rtc_time time;
+	rtc_split(utc, &time);
+	sprintf_P(buf, time_P, time.year, time.month, time.day, 
+		time.hour, time.minute, time.second);
+}
+
+
+
+/*
+ * Parse the given string into the actual position.
+ * example:
+ * $GPSACP: 120631.999,5433.9472N,00954.8768E,1.0,46.5,3,167.28,0.36,0.19,130707,11\r
+ */
+void parse_gps(char *gps_msg) {
+
+	gps_fields fields;
+	gps_position pos;
+	uint8_t hdop = 0;
+	uint8_t fix;
+	rtc_time utc;
+	
+	if (!gps_split(gps_msg, &fields)) {
+		return;
+	}
+	hdop = gps_hdop(fields.hdop);
+	fix = fields.fix[0];
+	gps_sats = atoi(fields.sats);
+	gps_hdop_tenths = hdop;
+
+	// a 2D fix may do if there is no 3D fix in time, see acquire_poll()
+	if ((fix >= '2') && (fix <= '3') &&
+			((config.max_hdop == 0) || (hdop <= config.max_hdop)) &&
+			gps_position_of(&fields, &pos)) {
+		pos.utc = 0;
+		if ((strlen(fields.time) == 6) && (strlen(fields.date) == 6)) {
+			utc.hour = gps_2digits(fields.time);
+			utc.minute = gps_2digits(fields.time + 2);
+			utc.second = gps_2digits(fields.time + 4);
+			utc.day = gps_2digits(fields.date);
+			utc.month = gps_2digits(fields.date + 2);
+			utc.year = gps_2digits(fields.date + 4);
+			if ((utc.month >= 1) && (utc.month <= 12) && (utc.day >= 1) && 
+					(utc.day <= 31) && (utc.hour < 24) && (utc.minute < 60) && 
+					(utc.second < 60) && (utc.year < 100)) {
+				pos.utc = rtc_make(&utc);
+				gps_ms = atoi(fields.ms);
+			}
+		}
+		act_gps_position = pos;
+	}
+
+}
+
+
+/*
+ * Switch the debug led on and off.
+ */
+void switch_led(void) {
+	static uint8_t led_on = FALSE;
+	if (led_on) {
+		PORTD &= ~(1 << MONITOR_LED);
+		led_on = FALSE;
+	}
+	else {
+		PORTD |= (1 << MONITOR_LED);
+		led_on = TRUE;
+	}
+}
+
+
+
+/* ---------------------------------
+ * menu definition
+ */
+const menu_item menu[] = {
+	{menu_P, 'm', show_menu},
+	{report_P, 'r', show_report},
+	{change_sms_P, 'a', change_sms},
+	{change_pin_P, 'p', change_pin},
+	{change_interval_P, 't', change_interval},
+	{switch_on_P, 'o', switch_modem},
+	{init_modem_P, 'i', init_modem},
+	//{network_status_P, 'n', network_status},
+	{send_sms_P, 's', send_position_sms},
+	{cold_gps_P, 'c', cold_gps},
+	{request_gps_P, 'g', request_gps},
+	{zones_P, 'z', show_zones},
+	{bench_P, 'b', show_bench},
+#ifdef ISR_PROFILE
+	{profile_P, 'l', show_profile},
+#endif
+}; 
+#define MAX_MENU_ITEMS (sizeof(menu) / sizeof(menu_item))
+
+
+
+/*
+ * Displays the menu.
+ */
+void show_menu(void) {
+	uint8_t i = 0;
+	
+	printf_P(cr_P);
+	printf_P(cr_P);
+	printf_P(line_P);
+	printf_P(firmware_P); printf_P(cr_P);
+	
+	for (i = 0; i < MAX_MENU_ITEMS; i++) {
+		printf("%c", menu[i].command);
+		printf_P(menu_option_P);
+		printf_P(menu[i].name);
+		printf_P(cr_P); 
+	}
+	printf_P(line_P);
+	printf_P(prompt_P);	
+	
+}
+
+
+
+/*
+ * Handles incomming commands.
+ * Tries to find a menu entry for the given command char.
+ * If a menu was found, the function gets executed.
+ */
+uint8_t handle_command(uint8_t command) {
+	uint8_t i = 0;
+
+	printf_P(cr_P);
+	
+	for (i = 0; i < MAX_MENU_ITEMS; i++) {
+		if (command == menu[i].command) {
+			printf_P(menu[i].name);
+			printf_P(cr_P);
+			if (menu[i].work) {
+				menu[i].work();
+			}
+			break;
+		}
+	}
+	if (i == MAX_MENU_ITEMS) {
+		printf_P(error_unknown_command_P, command);
+	}
+	
+	return 0;
+}
+
+
+
+/* ---------------------------------
+ * binary protocol commands
+ */
+
+/*
+ * Sends the status record.
+ */
+void proto_status(uint8_t *payload, uint8_t length) {
+	status_record status;
+	status.version = PROTO_VERSION;
+	status.reboots = reboots;
+	status.uptime = timer_uptime();
+	status.utc = rtc_now();
+	status.mode = mode;
+	status.modem_state = modem_state;
+	status.duty = idle_duty();
+	status.log_count = poslog_count();
+	status.position = act_gps_position;
+	proto_send(PROTO_STATUS | PROTO_REPLY, &status, sizeof(status));
+}
+
+
+
+/*
+ * Sends the config.
+ */
+void proto_config_read(uint8_t *payload, uint8_t length) {
+	proto_send(PROTO_CONFIG_READ | PROTO_REPLY, &config, sizeof(config));
+}
+
+
+
+/*
+ * Replaces the config. The CRC is calculated here, the frame
+ * is protected by its own CRC.
+ */
+void proto_config_write(uint8_t *payload, uint8_t length) {
+	beacon_config *new_config = (beacon_config *)payload;
+	if ((length != sizeof(beacon_config)) 
+			|| (new_config->version != CONFIG_VERSION)
+			|| (new_config->report_interval < CONFIG_INTERVAL_MIN)
+			|| (new_config->report_interval > CONFIG_INTERVAL_MAX)) {
+		proto_nak(PROTO_ERR_PAYLOAD);
+		return;
+	}
+	new_config->pin[CONFIG_PIN_SIZE - 1] = 0;
+	new_config->sms_gateway[CONFIG_NUMBER_SIZE - 1] = 0;
+	new_config->smsc[CONFIG_NUMBER_SIZE - 1] = 0;
+	new_config->master[CONFIG_NUMBER_SIZE - 1] = 0;
+	memcpy(&config, new_config, sizeof(beacon_config));
+	config_save();
+	timer_stop(TIMER_REPORT);	// restarted with the next report
+	proto_config_read(payload, 0);
+}
+
+
+
+/*
+ * Streams the position log, starting at the record given in the
+ * first payload byte. Frames are sent back to back, a frame 
+ * without payload ends the transfer.
+ */
+void proto_log_read(uint8_t *payload, uint8_t length) {
+	uint8_t index = (length > 0) ? payload[0] : 0;
+	uint8_t count = poslog_count();
+	uint8_t n = 0;
+	poslog_record *record = (poslog_record *)payload;
+	while (index < count) {
+		for (n = 0; (n < PROTO_MAX_PAYLOAD / sizeof(poslog_record)) 
+				&& (index < count); n++) {
+			poslog_read(index++, &record[n]);
+		}
+		proto_send(PROTO_LOG_READ | PROTO_REPLY, payload, 
+			n * sizeof(poslog_record));
+		wdt_reset();
+	}
+	proto_send(PROTO_LOG_READ | PROTO_REPLY, 0, 0);
+}
+
+
+/*
+ * Sends the zone given in the first payload byte, preceded by
+ * its index.
+ */
+void proto_zone_read(uint8_t *payload, uint8_t length) {
+	uint8_t index = payload[0];
+	if ((length != 1) || (index >= GEOFENCE_ZONES)) {
+		proto_nak(PROTO_ERR_PAYLOAD);
+		return;
+	}
+	geofence_read(index, (geofence_zone *)(payload + 1));
+	proto_send(PROTO_ZONE_READ | PROTO_REPLY, payload, 
+		1 + sizeof(geofence_zone));
+}
+
+
+
+/*
+ * Replaces a zone, payload is the index followed by the zone.
+ */
+void proto_zone_write(uint8_t *payload, uint8_t length) {
+	geofence_zone *zone = (geofence_zone *)(payload + 1);
+	if ((length != 1 + sizeof(geofence_zone)) || 
+			(payload[0] >= GEOFENCE_ZONES) || !geofence_valid(zone)) {
+		proto_nak(PROTO_ERR_PAYLOAD);
+		return;
+	}
+	geofence_write(payload[0], zone);
+	proto_zone_read(payload, 1);
+}
+
+
+#ifdef UART_CAPTURE
+/*
+ * Starts (payload 1) or stops (payload 0) the capture of the modem
+ * traffic. Answers the number of bytes in the ring.
+ */
+void proto_capture(uint8_t *payload, uint8_t length) {
+	if (length == 1) {
+		if (payload[0]) {
+			capture_start();
+		}
+		else {
+			capture_enable(FALSE);
+		}
+	}
+	payload[0] = capture_count();
+	proto_send(PROTO_CAPTURE | PROTO_REPLY, payload, 1);
+}
+
+
+
+/*
+ * Streams the bytes of the capture ring, oldest first. Recording is
+ * paused meanwhile. A frame without payload ends the transfer.
+ */
+void proto_capture_read(uint8_t *payload, uint8_t length) {
+	uint8_t recording = capture_enable(FALSE);
+	uint8_t count = capture_count();
+	uint8_t index = 0;
+	uint8_t n = 0;
+	while (index < count) {
+		for (n = 0; (n < PROTO_MAX_PAYLOAD) && (index < count); n++) {
+			payload[n] = capture_read(index++);
+		}
+		proto_send(PROTO_CAPTURE_READ | PROTO_REPLY, payload, n);
+		wdt_reset();
+	}
+	proto_send(PROTO_CAPTURE_READ | PROTO_REPLY, 0, 0);
+	capture_enable(recording);
+}
+#endif
+
+
+const proto_command proto_commands[] = {
+	{PROTO_STATUS, proto_status},
+	{PROTO_CONFIG_READ, proto_config_read},
+	{PROTO_CONFIG_WRITE, proto_config_write},
+	{PROTO_LOG_READ, proto_log_read},
+	{PROTO_ZONE_READ, proto_zone_read},
+	{PROTO_ZONE_WRITE, proto_zone_write},
+#ifdef UART_CAPTURE
+	{PROTO_CAPTURE, proto_capture},
+	{PROTO_CAPTURE_READ, proto_capture_read},
+#endif
+};
+#define PROTO_COMMANDS (sizeof(proto_commands) / sizeof(proto_command))
+
+
+
+/*
+ * Displays all status informations.
+ */
+void show_report(void) {
+	char buffer[21];
+	uint32_t uptime = timer_uptime();
+	uint8_t seconds = uptime % 60;
+	uint8_t minutes = (uptime / 60) % 60;
+	uint8_t hours = (uptime / 3600) % 24;
+	uint16_t days = uptime / 86400L;
+	uint8_t i;
+	
+	printf_P(reboots_P, reboots, resets[0], resets[1], resets[2], resets[3]);
+	
+	printf_P(uptime_P, days, hours, minutes, seconds);	
+	if (rtc_valid()) {
+		format_time(buffer, rtc_now());
+		printf_P(utc_P, buffer, rtc_drift());
+	}
+	
+	printf_P(sms_gateway_P, config.sms_gateway);
+	printf_P(pin_P, config.pin);
+	printf_P(interval_P, config.report_interval);
+	
+	printf_P(modem_state_P, modem_state);
+	printf_P(sms_stats_P, sms_sent, sms_failed, 
+		sms_sent ? sms_latency_sum / sms_sent : 0, sms_latency_max);
+	for (i = 0; i < AT_CMDS; i++) {
+		printf_P(at_stats_P, i, at_retries[i], at_failures[i]);
+	}
+	printf_P(aterr_P, aterr_count[ATERR_TIMEOUT], aterr_count[ATERR_TRANSIENT], 
+		aterr_count[ATERR_SIM], aterr_count[ATERR_NETWORK], aterr_count[ATERR_OTHER]);
+	printf_P(escalation_P, modem_reinits, modem_power_cycles);
+	printf_P(session_P, modem_session, session_saved);
+	printf_P(baud_P, uart_rate_baud(uart_rate), uart_rate_error(uart_rate), 
+		baud_fallbacks);
+	printf_P(eeprom_P, eeq_written, eeq_skipped);
+	printf_P(uart_dropped_P, uart_dropped);
+	printf_P(pool_P, pool_peak, POOL_BUFFERS, pool_misses);
+	printf_P(ram_P, ram_static(), ram_stack_unused());
+	printf_P(cell_stats_P, cell_stats[0], cell_stats[1]);
+	printf_P(remote_stats_P, remote_commands, remote_rejected);
+	printf_P(filter_P, gps_filter.count[FILTER_OK], gps_filter.count[FILTER_STALE], 
+		gps_filter.count[FILTER_SATS], gps_filter.count[FILTER_HDOP], 
+		gps_filter.count[FILTER_JUMP]);
+	printf_P(acquire_P, acquire_fixes, acquire_polls, 
+		acquire_fixes ? acquire_ttf_sum / acquire_fixes : 0, acquire_ttf_max);
+	printf_P(coverage_P, coverage_csq, coverage_registered, coverage_samples, 
+		defer_count, defer_expired);
+	for (i = 0; i < COVERAGE_BUCKETS; i++) {
+		printf_P(coverage_stat_P, (i < COVERAGE_BUCKETS - 1) ? i * 8 : COVERAGE_UNKNOWN, 
+			coverage_stats[i].sent, coverage_stats[i].failed, coverage_stats[i].sent ? 
+			coverage_stats[i].latency_sum / coverage_stats[i].sent : 0);
+	}
+	printf_P(wakeups_P, idle_wakeups[WAKE_TIMER], idle_wakeups[WAKE_UART], 
+		idle_wakeups[WAKE_SUART]);
+	printf_P(duty_P, idle_duty());
+	
+}
+
+
+
+/*
+ * Benchmarks, each runs an operation on bench_buf.
+ */
+static char *bench_buf;
+static volatile uint16_t bench_octets;
+static uint8_t bench_length;
+static uint16_t bench_word;
+
+void bench_gps(void) {
+	gps_fields fields;
+	gps_position pos;
+	gps_split(bench_buf, &fields);
+	gps_hdop(fields.hdop);
+	gps_position_of(&fields, &pos);
+}
+
+void bench_format(void) {
+	char time[21];
+	format_time(time, act_gps_position.utc);
+	sprintf_P(bench_buf, google_maps_P,  
+		act_gps_position.lat_deg, act_gps_position.lat_min,
+		act_gps_position.lon_deg, act_gps_position.lon_min, time);
+}
+
+void bench_sink(uint8_t octet) {
+	bench_octets++;
+}
+
+void bench_pack(void) {
+	sms_pack7(bench_sink, bench_buf, bench_length, 0);
+}
+
+void bench_uart(void) {
+	uart_puts_P(AT_P);
+	uart_putc('\r');
+}
+
+void bench_ee_read(void) {
+	bench_word = eeprom_read_word(&reboot_counter);
+}
+
+void bench_ee_write(void) {
+	eeprom_write_word(&reboot_counter, bench_word);
+}
+
+// a synthetic track, not recorded, fixes every 10 s, with a jump, a 
+// stale fix, a fix with too few satellites and a move the filter 
+// first takes for jumps. It only gives the cycles per fix, the 
+// decisions of the filter are checked by host/filtertest.
+#define BENCH_TRACK 12
+const filter_fix bench_track_P[BENCH_TRACK] PROGMEM = {
+	{53565786, 9914613, 237643200, 0, 12, 7},
+	{53566701, 9914650, 237643210, 10, 12, 7},
+	{53567588, 9914702, 237643220, 20, 11, 7},
+	{53568490, 9914713, 237643230, 30, 11, 8},
+	{53614112, 9914731, 237643240, 40, 14, 6},
+	{53570288, 9914779, 237643250, 50, 11, 8},
+	{53570288, 9914779, 237643230, 60, 11, 8},
+	{53572105, 9914820, 237643270, 70, 25, 2},
+	{53573012, 9914871, 237643280, 80, 10, 8},
+	{54473901, 9914900, 237643290, 90, 10, 8},
+	{54474822, 9914931, 237643300, 100, 10, 8},
+	{54475730, 9914969, 237643310, 110, 10, 8},
+};
+
+void bench_filter(void) {
+	filter_state state;
+	filter_fix fix;
+	uint8_t i;
+	memset(&state, 0, sizeof(state));
+	for (i = 0; i < BENCH_TRACK; i++) {
+		memcpy_P(&fix, &bench_track_P[i], sizeof(fix));
+		filter_check(&state, &fix);
+	}
+}
+
+
+
+/*
+ * Runs an operation and prints the cycles and the time per item.
+ * runs		how often the operation is run
+ * items	items per run, e.g. chars
+ */
+void bench_run(const char *name, void (*op)(void), uint8_t runs, uint8_t items) {
+	uint32_t cycles;
+	uint8_t i;
+	bench_start();
+	for (i = 0; i < runs; i++) {
+		op();
+	}
+	if (op == bench_uart) {
+		uart_flush();		// until the last char is in the shift register
+	}
+	cycles = bench_cycles() / runs / items;
+	bench_stop();
+	printf_P(bench_line_P, name, cycles, cycles / (F_CPU / 1000000));
+	wdt_reset();
+}
+
+
+
+/*
+ * Measures the parser, the formatters, the modem uart and the EEPROM.
+ * Timer 1 counts the cycles, the soft UART is stopped meanwhile.
+ */
+void show_bench(void) {
+	bench_buf = pool_acquire();
+	if (!bench_buf) {
+		return;
+	}
+	strcpy_P(bench_buf, bench_response_P);
+	bench_run(bench_gps_P, bench_gps, 10, 1);
+	bench_run(bench_format_P, bench_format, 10, 1);
+	bench_length = strlen(bench_buf);
+	bench_run(bench_pack_P, bench_pack, 10, bench_length);
+	bench_run(bench_filter_P, bench_filter, 10, BENCH_TRACK);
+	// the modem answers OK to each AT, the answers are dropped
+	bench_run(bench_uart_P, bench_uart, 8, 3);
+	wait_ms(200);
+	while (uart_getc() != UART_NO_DATA) {
+		;
+	}
+	eeq_flush();
+	bench_run(bench_ee_read_P, bench_ee_read, 10, 1);
+	bench_run(bench_ee_write_P, bench_ee_write, 1, 1);
+	pool_release(bench_buf);
+}
+
+
+
+/*
+ * Lists the zones and measures the time for a check of the actual
+ * position against the max number of zones. The benchmark zones 
+ * are zigzags around the position where every edge crosses the 
+ * ray of the test, the worst case. The cycles are counted with the
+ * bench timer, the ms tick is too coarse for a single check.
+ */
+#define ZONE_BENCH_RUNS 10
+void show_zones(void) {
+	geofence_zone zone;
+	int32_t lat = to_udeg(act_gps_position.lat_deg, act_gps_position.lat_min);
+	int32_t lon = to_udeg(act_gps_position.lon_deg, act_gps_position.lon_min);
+	uint8_t entered;
+	uint8_t left;
+	uint8_t inside;
+	uint8_t i;
+	uint8_t n;
+	uint32_t cycles;
+	for (i = 0; i < GEOFENCE_ZONES; i++) {
+		geofence_read(i, &zone);
+		if (zone.type == GEOFENCE_CIRCLE) {
+			printf_P(zone_circle_P, i, zone.lat, zone.lon, zone.shape.radius);
+		}
+		else if (zone.type == GEOFENCE_POLYGON) {
+			printf_P(zone_polygon_P, i, zone.lat, zone.lon, zone.count);
+		}
+	}
+	inside = geofence_update(lat, lon, &entered, &left);
+
+	zone.type = GEOFENCE_POLYGON;
+	zone.count = GEOFENCE_VERTICES;
+	zone.lat = lat - 100;
+	zone.lon = lon - 100;
+	for (i = 0; i < GEOFENCE_VERTICES; i++) {
+		zone.shape.vertex[i][0] = (i & 1) ? 20 : 0;
+		zone.shape.vertex[i][1] = i * 4;
+	}
+	bench_start();
+	for (n = 0; n < ZONE_BENCH_RUNS; n++) {
+		for (i = 0; i < GEOFENCE_ZONES; i++) {
+			geofence_inside(&zone, lat, lon);
+		}
+	}
+	cycles = bench_cycles() / ZONE_BENCH_RUNS;
+	bench_stop();
+	printf_P(zone_state_P, inside, cycles, cycles / (F_CPU / 1000000), 
+		GEOFENCE_ZONES);
+}
+
+
+
+#ifdef ISR_PROFILE
+/*
+ * Shows the interrupt profile since the last call and restarts it.
+ * Latencies include the time other handlers blocked the interrupt,
+ * the largest exec_max is the longest time interrupts were blocked
+ * by a handler.
+ */
+void show_profile(void) {
+	profile_stat stats[PROFILE_COUNT];
+	uint8_t i;
+	cli();
+	memcpy(stats, profile_stats, sizeof(stats));
+	sei();
+	profile_reset();
+	printf_P(profile_head_P);
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		printf_P(profile_line_P, i, stats[i].count, 
+			(stats[i].latency_min != 0xffff) ? stats[i].latency_min : 0, 
+			stats[i].latency_max, stats[i].exec_max);
+	}
+}
+#endif
+
+
+
+/*
+ * Shows a config value, reads user input into it and stores
+ * the config back to eeprom.
+ */
+void modify_str(char* str, uint8_t size) {
+	char buffer[CONFIG_NUMBER_SIZE];
+	uint8_t i;
+	int c;
+	printf_P(old_value_P, str);
+	for (i = 0; i < size - 1; i++) {
+		while ((c = suart_getc_nowait()) == -1) {
+			wdt_reset();
+		}
+		if (c == '\r') {
+			break;
+		}
+		buffer[i] = c;
+	}
+	buffer[i] = 0;
+	memcpy(str, buffer, i + 1);
+	config_save();
+}
+
+
+
+/*
+ * change_sms
+ */
+void change_sms(void) {
+	modify_str(config.sms_gateway, CONFIG_NUMBER_SIZE);
+}
+
+/*
+ * Change the pin.
+ */
+void change_pin(void) {
+	modify_str(config.pin, CONFIG_PIN_SIZE);
+}
+
+/*
+ * Change the report interval [s], CONFIG_INTERVAL_MIN..MAX.
+ */
+void change_interval(void) {
+	char buffer[6];
+	char *end;
+	uint32_t interval;
+	utoa(config.report_interval, buffer, 10);
+	modify_str(buffer, sizeof(buffer));
+	interval = strtoul(buffer, &end, 10);
+	if ((end == buffer) || (*end != 0) || (interval < CONFIG_INTERVAL_MIN) || 
+			(interval > CONFIG_INTERVAL_MAX)) {
+		printf_P(interval_range_P, CONFIG_INTERVAL_MIN, CONFIG_INTERVAL_MAX);
+		return;
+	}
+	config.report_interval = interval;
+	config_save();
+	timer_stop(TIMER_REPORT);	// restarted with the next report
+}
+
+
+#define MODE_NONE			0
+#define MODE_SWITCH_MODEM	1
+#define MODE_INIT_MODEM		2
+#define MODE_REQUEST_GPS	3
+#define MODE_SEND_POSITION	4
+#define MODE_SEND_CELL		5
+#define MODE_WAIT			100
+#define MODE_WAIT2			101
+#define MODE_ERRORED		102
+#define MODE_STOP			103
+
+
+
+/*
+ * Timer callback, ends MODE_WAIT.
+ */
+void mode_wakeup(void) {
+	if (mode == MODE_WAIT) {
+		mode = next_mode;
+	}
+}
+
+
+
+/*
+ * Escalation of commands after the initialization: if one failed
+ * for good, the modem is initialized again, and power cycled if 
+ * that fails too, see MODE_INIT_MODEM.
+ * return	uint8_t	TRUE if the modem is initialized again
+ */
+uint8_t modem_failed(void) {
+	if (modem_state != MODEM_ERRORED) {
+		return FALSE;
+	}
+	modem_reinits++;
+	mode = MODE_INIT_MODEM;
+	return TRUE;
+}
+
+
+
+/*
+ * Starts the timer for the next report. With a valid clock the
+ * report is aligned to the next UTC slot of the report interval,
+ * otherwise it runs periodically from the first report.
+ */
+void schedule_report(void) {
+	if (rtc_valid()) {
+		report_due = FALSE;
+		timer_start(TIMER_REPORT, rtc_until(config.report_interval), 0, 
+			report_wakeup);
+	}
+	else if (!timer_active(TIMER_REPORT)) {
+		report_due = FALSE;
+		timer_start(TIMER_REPORT, config.report_interval * 1000L, 
+			config.report_interval * 1000L, report_wakeup);
+	}
+}
+
+
+
+/*
+ * Timer callback, a report is due. Ends MODE_WAIT2, or the next
+ * MODE_WAIT2 right away if the position is still being acquired.
+ */
+void report_wakeup(void) {
+	report_due = TRUE;
+}
+
+
+int main(void) {
+	
+	uint8_t i = 0;
+	uint16_t command = 0;
+	uint8_t last_mode = MODE_NONE;
+	uint8_t reset_flags = MCUCSR;
+	uint8_t resumed = FALSE;
+
+	init_timer();
+	
+
+	// enable monitor led
+	DDRD |= (1 << MONITOR_LED);
+	
+	// enable on/off switch
+	DDRC |= (1 << MODEM_ON_SWITCH);
+	PORTC &= ~(1 << MODEM_ON_SWITCH);
+
+	// clear reset flags, check for a watchdog reset
+	MCUCSR = 0;
+	if ((reset_flags & (1 << WDRF)) && resume_valid()) {
+		resumed = TRUE;
+	}
+
+	// say hello, not after a watchdog reset
+	if (!resumed) {
+		for (i = 0; i < 10; i++) {
+			switch_led();
+			_delay_ms(100);
+		}
+		for (i = 0; i < 200; i++) {
+			_delay_ms(100);
+		}
+		switch_led();
+	}
+	
+	init_uart();	
+	init_suart();
+	init_idle();
+#ifdef ISR_PROFILE
+	profile_reset();
+#endif
+	sei();
+	inc_reboot_counter(reset_flags);
+	config_load();
+	poslog_init();
+	
+	stdout = stdin = &uart_file;
+
+	if (resumed) {
+		modem_state = resume.modem_state;
+		act_gps_position = resume.position;
+		mode = resume.mode;
+		next_mode = resume.next_mode;
+		printf_P(resumed_P, mode);
+		set_rate(resume.uart_rate);
+		if ((mode == MODE_WAIT) || (mode == MODE_WAIT2)) {
+			// timers have restarted, the wakeup time is lost
+			mode = next_mode;
+		}
+		if ((modem_state != MODEM_OFF) && (mode != MODE_STOP)) {
+			// modem should still be on, check before resuming
+			char buf[30];
+			if (!request_modem(AT_P, 0, 1000, TRUE, buf, sizeof(buf))) {
+				mode = MODE_ERRORED;
+			}
+		}
+	}
+
+	wdt_enable(WDTO_2S);
+		
+	while (TRUE) {
+
+		wdt_reset();
+		timer_poll();
+		if (mode != last_mode) {
+			save_resume();
+			last_mode = mode;
+		}
+		
+		switch (mode) {
+			case MODE_NONE:
+				show_menu();
+				mode = MODE_SWITCH_MODEM;
+				break;
+			case MODE_SWITCH_MODEM:
+				printf_P(switch_on_P); printf_P(cr_P);
+				switch_modem();
+				//mode = MODE_WAIT;
+				mode = MODE_STOP;
+				next_mode = MODE_INIT_MODEM;
+				timer_start(TIMER_MODE, 10000, 0, mode_wakeup);
+				break;
+			case MODE_INIT_MODEM:
+				printf_P(init_modem_P); printf_P(cr_P);
+				init_modem();
+				if (modem_state != MODEM_ERRORED) {
+					modem_reinit = 0;
+					next_mode = MODE_REQUEST_GPS;
+					timer_start(TIMER_COVERAGE, COVERAGE_PERIOD, COVERAGE_PERIOD, 
+						coverage_wakeup);
+				}
+				else if (modem_reinit < MODEM_REINITS) {
+					// second tier, try the sequence again
+					modem_reinit++;
+					modem_reinits++;
+					next_mode = MODE_INIT_MODEM;
+				}
+				else {
+					// last tier, power cycle
+					modem_reinit = 0;
+					next_mode = MODE_ERRORED;
+				}
+				mode = MODE_WAIT;
+				timer_start(TIMER_MODE, 15000, 0, mode_wakeup);
+				break;
+			case MODE_REQUEST_GPS:
+				request_gps();
+				if (modem_failed()) {
+					break;
+				}
+				if (modem_state == MODEM_POS_FIX) {
+					nofix_active = FALSE;
+					mode = MODE_SEND_POSITION;
+				}
+				else if (!gps_held && nofix_expired()) {
+					mode = MODE_SEND_CELL;
+				}
+				else {
+					mode = MODE_WAIT;
+					next_mode = MODE_REQUEST_GPS;
+					timer_start(TIMER_MODE, gps_wait, 0, mode_wakeup);
+				}
+				break;
+			case MODE_SEND_POSITION:
+				if (!send_gate()) {
+					if (modem_failed()) {
+						break;
+					}
+					mode = MODE_WAIT;
+					next_mode = MODE_SEND_POSITION;
+					timer_start(TIMER_MODE, COVERAGE_RETRY, 0, mode_wakeup);
+					break;
+				}
+				if (config.report_mode == REPORT_GEOFENCE) {
+					send_zone_events();
+				}
+				else {
+					send_position_sms();
+				}
+				schedule_report();
+				mode = MODE_WAIT2;
+				next_mode = MODE_REQUEST_GPS;
+				modem_failed();
+				break;
+			case MODE_SEND_CELL:
+				if (!send_gate()) {
+					if (modem_failed()) {
+						break;
+					}
+					mode = MODE_WAIT;
+					next_mode = MODE_SEND_CELL;
+					timer_start(TIMER_MODE, COVERAGE_RETRY, 0, mode_wakeup);
+					break;
+				}
+				send_cell_report();
+				schedule_report();
+				mode = MODE_WAIT2;
+				next_mode = MODE_REQUEST_GPS;
+				modem_failed();
+				break;
+			case MODE_WAIT:
+				// left by mode_wakeup()
+				break;
+			case MODE_WAIT2:
+				if (report_due) {
+					report_due = FALSE;
+					mode = next_mode;
+				}
+				else if (coverage_due) {
+					coverage_due = FALSE;
+					if ((modem_state == MODEM_INITIALIZED) || 
+							(modem_state == MODEM_POS_FIX)) {
+						sample_coverage();
+						modem_failed();
+					}
+				}
+				else if (inbox_due) {
+					inbox_due = FALSE;
+					if ((modem_state == MODEM_INITIALIZED) || 
+							(modem_state == MODEM_POS_FIX)) {
+						check_inbox();
+						modem_failed();
+					}
+				}
+				else {
+					// unsolicited lines of the modem
+					char urc[8];
+					if (uart_gets(urc, sizeof(urc)) && 
+							(strncmp_P(urc, CMTI_P, 6) == 0)) {
+						inbox_due = TRUE;
+					}
+				}
+				break;
+			case MODE_ERRORED:
+				printf_P(error_P);
+				timer_stop(TIMER_COVERAGE);
+				modem_power_cycles++;
+				mode = MODE_SWITCH_MODEM;				
+				break;
+			case MODE_STOP:
+				break;
+			default:
+				break;
+		}
+	
+		
+		command = suart_getc_nowait();
+		switch (command) {
+			case -1:
+			case '\r':
+			case '\n':
+				break;
+			case PROTO_SOF:
+				proto_handle(proto_commands, PROTO_COMMANDS);
+				break;
+			case '1':
+				if (mode == MODE_WAIT) {
+					mode = MODE_STOP;
+				}
+				else {
+					next_mode = mode;
+					mode = MODE_STOP;
+				}
+				printf_P(interactive_P);
+				break;
+			case '2':
+				mode = next_mode;
+				next_mode = MODE_NONE;
+				printf_P(run_P);
+				break; 
+			default:
+				handle_command(command);
+				break;
+		}
+
+		// nothing to do until the next interrupt
+		if ((mode == MODE_WAIT) || (mode == MODE_STOP) || 
+				((mode == MODE_WAIT2) && !report_due)) {
+			idle_sleep();
+		}
+		
+	}
+	
+	return 0;
+	
+}
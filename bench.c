@@ -0,0 +1,95 @@
+/* ----------------------------------------------------
+ * File    : bench.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Cycle counter for benchmarks, see bench.h.
+ */
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "bench.h"
+
+#define TIMER1_INTERRUPTS ((1 << TICIE1) | (1 << OCIE1A) | (1 << OCIE1B) | (1 << TOIE1))
+#define TIMER1_FLAGS ((1 << ICF1) | (1 << OCF1A) | (1 << OCF1B) | (1 << TOV1))
+
+static volatile uint16_t overflows = 0;
+
+// timer 1 before the benchmark
+static uint8_t saved_tccr1a;
+static uint8_t saved_tccr1b;
+static uint16_t saved_ocr1a;
+static uint8_t saved_timsk;
+
+
+
+/*
+ * bench_start
+ */
+void bench_start(void) {
+	// last frames of the soft UART, out and in
+	while (TIMSK & ((1 << OCIE1A) | (1 << OCIE1B))) {
+		;
+	}
+	cli();
+	saved_tccr1a = TCCR1A;
+	saved_tccr1b = TCCR1B;
+	saved_ocr1a = OCR1A;
+	saved_timsk = TIMSK & TIMER1_INTERRUPTS;
+	TIMSK &= ~TIMER1_INTERRUPTS;
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);		// normal mode, full clock
+	TCNT1 = 0;
+	overflows = 0;
+	TIFR = (1 << TOV1);
+	TIMSK |= (1 << TOIE1);
+	sei();
+}
+
+
+
+/*
+ * bench_cycles
+ */
+uint32_t bench_cycles(void) {
+	uint8_t sreg = SREG;
+	uint16_t count;
+	uint16_t high;
+	cli();
+	count = TCNT1;
+	high = overflows;
+	if ((TIFR & (1 << TOV1)) && (count < 0x8000)) {
+		high++;		// overflow not handled yet
+	}
+	SREG = sreg;
+	return ((uint32_t)high << 16) | count;
+}
+
+
+
+/*
+ * bench_stop
+ */
+void bench_stop(void) {
+	uint8_t sreg = SREG;
+	cli();
+	TIMSK &= ~TIMER1_INTERRUPTS;
+	TCCR1A = saved_tccr1a;
+	TCCR1B = saved_tccr1b;
+	OCR1A = saved_ocr1a;
+	TCNT1 = 0;
+	TIFR = TIMER1_FLAGS;		// raised meanwhile, not for the old setup
+	TIMSK |= saved_timsk;
+	SREG = sreg;
+}
+
+
+
+/*
+ * SIGNAL Timer 1 overflow
+ */
+SIGNAL(TIMER1_OVF_vect) {
+	overflows++;
+}
@@ -0,0 +1,38 @@
+/* ----------------------------------------------------
+ * File    : bench.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Cycle counter for benchmarks on the device. Timer 1 is taken from
+ * the soft UART and the interrupt profiler and runs freely at full 
+ * clock, overflows are counted in an interrupt. Nothing can be 
+ * printed while the counter runs. Other interrupts keep running and
+ * are included in the counts.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <inttypes.h>
+
+/*
+ * bench_start
+ * Waits until the soft UART has sent and received its last char,
+ * saves the setup of timer 1, then starts counting cycles from 0.
+ */
+void bench_start(void);
+
+/*
+ * bench_cycles
+ * return	uint32_t	cycles since bench_start()
+ */
+uint32_t bench_cycles(void);
+
+/*
+ * bench_stop
+ * Restores timer 1 as it was before bench_start().
+ */
+void bench_stop(void);
+
+#endif /*BENCH_H_*/
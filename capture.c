@@ -0,0 +1,145 @@
+/* ----------------------------------------------------
+ * File    : capture.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Capture of the modem UART traffic, see capture.h.
+ */
+
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include "capture.h"
+#include "timer.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+#ifdef UART_CAPTURE
+
+#define CAPTURE_MASK (CAPTURE_SIZE - 1)
+#if (CAPTURE_SIZE & CAPTURE_MASK)
+	#error CAPTURE_SIZE is not a power of 2
+#endif
+
+static uint8_t ring[CAPTURE_SIZE];
+static volatile uint8_t head = 0;
+static volatile uint8_t count = 0;
+static volatile uint8_t recording = FALSE;
+static uint32_t last = 0;
+static uint8_t last_direction = CAPTURE_RX;
+static uint8_t run = CAPTURE_RUN;		// plain bytes since the last mark
+
+
+
+/*
+ * Drops the oldest runs until n bytes are free. The ring always 
+ * starts with a mark.
+ */
+static void make_room(uint8_t n) {
+	uint8_t tail;
+	while (CAPTURE_SIZE - count < n) {
+		tail = (head - count) & CAPTURE_MASK;
+		count -= ((ring[tail] & CAPTURE_TICKS) == CAPTURE_GAP) ? 4 : 2;
+		while ((count > 0) && !(ring[(head - count) & CAPTURE_MASK] & CAPTURE_MARK)) {
+			count--;
+		}
+	}
+}
+
+
+
+static void put(uint8_t data) {
+	ring[head] = data;
+	head = (head + 1) & CAPTURE_MASK;
+	count++;
+}
+
+
+
+/*
+ * capture_byte
+ */
+void capture_byte(uint8_t direction, uint8_t data) {
+	uint32_t now;
+	uint32_t ticks;
+	if (!recording) {
+		return;
+	}
+	now = timer_millis();
+	ticks = (now - last) / CAPTURE_TICK_MS;
+	last = now;
+	if ((ticks == 0) && (direction == last_direction) && 
+			(run < CAPTURE_RUN) && !(data & CAPTURE_MARK)) {
+		make_room(1);
+		put(data);
+		run++;
+		return;
+	}
+	if (ticks >= CAPTURE_GAP) {
+		if (ticks > 0xffff) {
+			ticks = 0xffff;
+		}
+		make_room(4);
+		put(CAPTURE_MARK | direction | CAPTURE_GAP);
+		put(ticks);
+		put(ticks >> 8);
+	}
+	else {
+		make_room(2);
+		put(CAPTURE_MARK | direction | ticks);
+	}
+	put(data);
+	last_direction = direction;
+	run = 0;
+}
+
+
+
+/*
+ * capture_start
+ */
+void capture_start(void) {
+	uint8_t sreg = SREG;
+	cli();
+	head = 0;
+	count = 0;
+	last = timer_millis();
+	run = CAPTURE_RUN;
+	recording = TRUE;
+	SREG = sreg;
+}
+
+
+
+/*
+ * capture_enable
+ */
+uint8_t capture_enable(uint8_t on) {
+	uint8_t was = recording;
+	recording = on;
+	return was;
+}
+
+
+
+/*
+ * capture_count
+ */
+uint8_t capture_count(void) {
+	return count;
+}
+
+
+
+/*
+ * capture_read
+ */
+uint8_t capture_read(uint8_t index) {
+	return ring[(head - count + index) & CAPTURE_MASK];
+}
+
+#endif /*UART_CAPTURE*/
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------
+ * File    : capture.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Capture of the modem UART traffic into a RAM ring, enabled by 
+ * compiling with -DUART_CAPTURE. The modem talks 7 bit ASCII, so 
+ * most bytes are stored as they are, one ring byte each. A byte 
+ * below 0x80 is sent in the direction of the byte before it, in the
+ * same timer tick. Any other byte is preceded by a mark: 
+ * CAPTURE_MARK, the direction and the ticks since the byte before, 
+ * 0..62. Longer pauses give a mark with CAPTURE_GAP and the pause 
+ * in ticks as two bytes, low first, pauses over 262s are recorded 
+ * as 262s. A mark is followed by its byte whatever its value. After
+ * CAPTURE_RUN plain bytes a mark is forced, the ring drops whole 
+ * runs when it is full and keeps the newest ones.
+ *
+ * The tick is the one of timer 0, 4ms, so that is the resolution
+ * of the times. The ring holds about 110 chars of modem traffic, a
+ * request and response of AT$GPSACP. It lives in RAM, the EEPROM 
+ * is full, so it is lost by a reset. To keep a failure until it is
+ * read, CAPTURE_FREEZE() stops the recording, beacon.c does so when
+ * a command fails for good, see modem_backoff(). Reading the ring 
+ * does not start it again, a new capture does.
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <inttypes.h>
+
+#define CAPTURE_RX		0x00
+#define CAPTURE_TX		0x40
+#define CAPTURE_MARK	0x80
+#define CAPTURE_TICKS	0x3f	// mask of the ticks in a mark
+#define CAPTURE_GAP		0x3f	// ticks of a mark with a pause
+#define CAPTURE_TICK_MS	4
+#define CAPTURE_RUN		16
+
+#ifdef UART_CAPTURE
+
+// bytes in the ring, must be a power of 2
+#define CAPTURE_SIZE	128
+#define CAPTURE_RAM		CAPTURE_SIZE
+
+/*
+ * capture_byte
+ * Records a byte, called by the UART interrupt handlers.
+ */
+void capture_byte(uint8_t direction, uint8_t data);
+
+/*
+ * capture_start
+ * Clears the ring and starts recording.
+ */
+void capture_start(void);
+
+/*
+ * capture_enable
+ * Pauses or resumes recording.
+ * return	uint8_t	TRUE if it was recording before
+ */
+uint8_t capture_enable(uint8_t on);
+
+/*
+ * capture_count
+ * return	uint8_t	number of bytes in the ring
+ */
+uint8_t capture_count(void);
+
+/*
+ * capture_read
+ * return	uint8_t	byte of the ring, index 0 is the oldest one
+ */
+uint8_t capture_read(uint8_t index);
+
+#define CAPTURE(direction, data) capture_byte((direction), (data))
+#define CAPTURE_FREEZE() capture_enable(0)
+
+#else
+
+#define CAPTURE(direction, data)
+#define CAPTURE_FREEZE()
+#define CAPTURE_RAM		0
+
+#endif /*UART_CAPTURE*/
+
+#endif /*CAPTURE_H_*/
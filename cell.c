@@ -0,0 +1,143 @@
+/* ----------------------------------------------------
+ * File    : cell.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Cell information, see cell.h.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "cell.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+const char moni_P[] PROGMEM = "#MONI:";
+const char creg_P[] PROGMEM = "+CREG:";
+const char cc_P[] PROGMEM   = "Cc:";
+const char nc_P[] PROGMEM   = "Nc:";
+const char lac_P[] PROGMEM  = "LAC:";
+const char id_P[] PROGMEM   = "Id:";
+const char pwr_P[] PROGMEM  = "PWR:";
+
+
+
+/*
+ * Value after the given tag, or -1 if there is no tag.
+ */
+static long tag_value(const char *line, const char *tag, uint8_t base) {
+	char *end;
+	long value;
+	const char *p = strstr_P(line, tag);
+	if (p == 0) {
+		return -1;
+	}
+	p += strlen_P(tag);
+	value = strtol(p, &end, base);
+	return (end == p) ? -1 : value;
+}
+
+
+
+/*
+ * Appends a cell, the same cell is not added twice.
+ */
+static uint8_t add_cell(cell_report *report, long lac, long ci, long dbm) {
+	uint8_t i;
+	cell_info *cell;
+	if ((lac < 0) || (ci < 0) || (lac > 0xffff) || (ci > 0xffff)) {
+		return FALSE;
+	}
+	for (i = 0; i < report->count; i++) {
+		if ((report->cell[i].lac == lac) && (report->cell[i].ci == ci)) {
+			return FALSE;
+		}
+	}
+	if (report->count == CELL_MAX) {
+		return FALSE;
+	}
+	cell = &report->cell[report->count++];
+	cell->lac = lac;
+	cell->ci = ci;
+	cell->dbm = ((dbm < 0) && (dbm > -128)) ? dbm : 0;
+	return TRUE;
+}
+
+
+
+/*
+ * cell_clear
+ */
+void cell_clear(cell_report *report) {
+	report->mcc = 0;
+	report->mnc = 0;
+	report->count = 0;
+}
+
+
+
+/*
+ * cell_parse_moni
+ */
+uint8_t cell_parse_moni(const char *line, cell_report *report) {
+	long value;
+	if (strncmp_P(line, moni_P, 6) != 0) {
+		return FALSE;
+	}
+	if ((value = tag_value(line, cc_P, 10)) > 0) {
+		report->mcc = value;
+		value = tag_value(line, nc_P, 10);
+		report->mnc = (value > 0) ? value : 0;
+	}
+	return add_cell(report, tag_value(line, lac_P, 16), 
+		tag_value(line, id_P, 16), tag_value(line, pwr_P, 10));
+}
+
+
+
+/*
+ * cell_parse_creg
+ */
+uint8_t cell_parse_creg(const char *line, cell_report *report) {
+	const char *lac;
+	const char *ci;
+	if (strncmp_P(line, creg_P, 6) != 0) {
+		return FALSE;
+	}
+	lac = strchr(line, '"');
+	ci = lac ? strchr(lac + 1, ',') : 0;
+	if ((lac == 0) || (ci == 0) || (ci[1] != '"')) {
+		return FALSE;
+	}
+	return add_cell(report, strtol(lac + 1, 0, 16), strtol(ci + 2, 0, 16), 0);
+}
+
+
+
+/*
+ * cell_encode
+ */
+uint8_t cell_encode(const cell_report *report, uint8_t *buf) {
+	uint8_t i;
+	uint8_t *p = buf + 5;
+	buf[0] = report->mcc & 0xff;
+	buf[1] = report->mcc >> 8;
+	buf[2] = report->mnc & 0xff;
+	buf[3] = report->mnc >> 8;
+	buf[4] = report->count;
+	for (i = 0; i < report->count; i++) {
+		p[0] = report->cell[i].lac & 0xff;
+		p[1] = report->cell[i].lac >> 8;
+		p[2] = report->cell[i].ci & 0xff;
+		p[3] = report->cell[i].ci >> 8;
+		p[4] = report->cell[i].dbm;
+		p += 5;
+	}
+	return p - buf;
+}
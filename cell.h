@@ -0,0 +1,66 @@
+/* ----------------------------------------------------
+ * File    : cell.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Cell information of the GM862, used as a coarse position when 
+ * there is no GPS fix. The serving and neighbour cells come from
+ * AT#MONI after AT#MONI=7, one line per cell:
+ * #MONI: Cc:262 Nc:01 BSIC:24 RxQual:0 LAC:D30D Id:2FA3 ARFCN:20 PWR:-71dbm TA:0
+ * #MONI: Adj Cell1 [LAC:D30D Id:2FA4] ARFCN:24 PWR:-80dbm
+ * If that fails, AT+CREG? with AT+CREG=2 gives the serving cell:
+ * +CREG: 2,1,"D30D","2FA3"
+ */
+
+#ifndef CELL_H_
+#define CELL_H_
+
+#include <inttypes.h>
+
+#define CELL_MAX 4
+
+typedef struct {
+	uint16_t lac;			// location area code
+	uint16_t ci;			// cell id
+	int8_t dbm;				// received power, 0 if unknown
+} cell_info;
+
+typedef struct {
+	uint16_t mcc;			// country code, 0 if unknown
+	uint16_t mnc;			// network code
+	uint8_t count;			// cells, the first one is the serving cell
+	cell_info cell[CELL_MAX];
+} cell_report;
+
+// size of an encoded report with n cells
+#define CELL_ENCODED_SIZE(n) (5 + 5 * (n))
+
+/*
+ * cell_clear
+ */
+void cell_clear(cell_report *report);
+
+/*
+ * cell_parse_moni
+ * Adds the cell of a #MONI line to the report.
+ * return	uint8_t	TRUE if the line held a cell
+ */
+uint8_t cell_parse_moni(const char *line, cell_report *report);
+
+/*
+ * cell_parse_creg
+ * Adds the serving cell of a +CREG line to the report.
+ * return	uint8_t	TRUE if the line held a cell
+ */
+uint8_t cell_parse_creg(const char *line, cell_report *report);
+
+/*
+ * cell_encode
+ * Encodes the report, little endian: mcc (2), mnc (2), count (1), 
+ * then lac (2), ci (2), dbm (1) per cell.
+ * return	uint8_t	length, CELL_ENCODED_SIZE(count)
+ */
+uint8_t cell_encode(const cell_report *report, uint8_t *buf);
+
+#endif /*CELL_H_*/
@@ -0,0 +1,99 @@
+/* ----------------------------------------------------
+ * File    : config.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Persistent configuration, see config.h.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "config.h"
+#include "eeq.h"
+#include "uart.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+
+// defaults, used if the EEPROM holds no valid config
+const beacon_config config_default PROGMEM = {
+	CONFIG_VERSION,
+	"1067",			// EDIT THIS! Insert your pin
+	"7676245",		// EDIT THIS! Where to send the SMS
+	120,			// report every two minutes
+	TRANSPORT_SMS_TEXT,
+	2,				// 2D fix is enough
+	0,				// accept any hdop
+	"",				// SMS center from SIM
+	REPORT_PERIODIC,
+	300,			// report the cell after 5 minutes without fix
+	0,				// don't wait for signal
+	300,			// but if so, not longer than 5 minutes
+	UART_RATE_115200,	// fastest rate that passes the echo test
+	60,				// accept 2D if there is no 3D a minute later
+	"",				// no commands by SMS
+	0
+};
+
+beacon_config config_ee EEMEM;
+
+beacon_config config;
+
+
+
+/*
+ * Calculates the CRC over all fields but the CRC itself.
+ */
+static uint16_t config_crc(void) {
+	uint16_t crc = 0xffff;
+	uint8_t *p = (uint8_t *)&config;
+	uint8_t i = 0;
+	for (i = 0; i < offsetof(beacon_config, crc); i++) {
+		crc = _crc16_update(crc, *p++);
+	}
+	return crc;
+}
+
+
+
+/*
+ * config_defaults
+ */
+void config_defaults(void) {
+	memcpy_P(&config, &config_default, sizeof(beacon_config));
+}
+
+
+
+/*
+ * config_load
+ */
+uint8_t config_load(void) {
+	eeq_flush();
+	eeprom_read_block(&config, &config_ee, sizeof(beacon_config));
+	if ((config.version == CONFIG_VERSION) && (config.crc == config_crc())) {
+		return TRUE;
+	}
+	config_defaults();
+	config_save();
+	return FALSE;
+}
+
+
+
+/*
+ * config_save
+ */
+void config_save(void) {
+	config.version = CONFIG_VERSION;
+	config.crc = config_crc();
+	eeq_write_block(&config, &config_ee, sizeof(beacon_config));
+}
+
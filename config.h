@@ -0,0 +1,80 @@
+/* ----------------------------------------------------
+ * File    : config.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Persistent configuration. One versioned block with a CRC is
+ * kept in EEPROM and loaded into RAM at boot. All code reads the
+ * RAM copy.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <inttypes.h>
+
+// increment on every change of the config struct
+#define CONFIG_VERSION 8
+
+#define CONFIG_PIN_SIZE 9
+#define CONFIG_NUMBER_SIZE 16
+
+// report interval [s] taken by the menu, the protocol and by SMS
+#define CONFIG_INTERVAL_MIN	60
+#define CONFIG_INTERVAL_MAX	43200
+
+#define TRANSPORT_SMS_TEXT		0	// text mode
+#define TRANSPORT_SMS_PDU		1	// PDU mode, 7 bit text
+#define TRANSPORT_SMS_BINARY	2	// PDU mode, 8 bit batch of positions
+
+#define REPORT_PERIODIC			0	// every position is reported
+#define REPORT_GEOFENCE			1	// only entering and leaving zones
+
+typedef struct {
+	uint8_t version;
+	char pin[CONFIG_PIN_SIZE];				// SIM pin
+	char sms_gateway[CONFIG_NUMBER_SIZE];	// where to send the SMS
+	uint16_t report_interval;				// seconds between reports
+	uint8_t transport;						// how reports are sent
+	uint8_t min_fix;						// 2: 2D fix, 3: 3D fix
+	uint8_t max_hdop;						// hdop * 10, 0: don't care
+	char smsc[CONFIG_NUMBER_SIZE];			// SMS center, empty: from SIM
+	uint8_t report_mode;					// what is reported
+	uint16_t nofix_timeout;					// s without fix until the cell 
+											// is reported, 0: never
+	uint8_t min_csq;						// reports wait for this signal,
+											// 0..31, 0: send at once
+	uint16_t max_defer;						// s a report may wait for signal
+	uint8_t modem_rate;						// highest baud rate tried with 
+											// the modem, see uart.h
+	uint16_t fix_budget;					// s a 3D fix is waited for after
+											// a 2D fix, 0: forever
+	char master[CONFIG_NUMBER_SIZE];		// commands by SMS are taken from
+											// it, empty: none, see remote.h
+	uint16_t crc;
+} beacon_config;
+
+extern beacon_config config;
+
+/*
+ * config_load
+ * Reads the config from EEPROM. If the version or CRC does not
+ * match, the defaults are used and written back.
+ * return	uint8_t	TRUE if the stored config was valid
+ */
+uint8_t config_load(void);
+
+/*
+ * config_save
+ * Updates the CRC and queues the config for writing to EEPROM.
+ */
+void config_save(void);
+
+/*
+ * config_defaults
+ * Replaces the RAM copy with the defaults.
+ */
+void config_defaults(void);
+
+#endif /*CONFIG_H_*/
@@ -0,0 +1,99 @@
+/* ----------------------------------------------------
+ * File    : coverage.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Network coverage, see coverage.h.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "coverage.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+const char csq_rssi_P[] PROGMEM  = "+CSQ: ";
+const char creg_stat_P[] PROGMEM = "+CREG: ";
+
+uint8_t coverage_csq = COVERAGE_UNKNOWN;
+uint8_t coverage_registered = FALSE;
+uint16_t coverage_samples = 0;
+coverage_stat coverage_stats[COVERAGE_BUCKETS];
+
+
+
+/*
+ * coverage_parse_csq
+ */
+uint8_t coverage_parse_csq(const char *response) {
+	const char *p = strstr_P(response, csq_rssi_P);
+	uint8_t csq;
+	if (p == 0) {
+		return FALSE;
+	}
+	csq = atoi(p + 6);
+	coverage_csq = (csq <= 31) ? csq : COVERAGE_UNKNOWN;
+	coverage_samples++;
+	return TRUE;
+}
+
+
+
+/*
+ * coverage_parse_creg
+ */
+uint8_t coverage_parse_creg(const char *response) {
+	const char *p = strstr_P(response, creg_stat_P);
+	uint8_t stat;
+	if (p == 0) {
+		return FALSE;
+	}
+	p = strchr(p, ',');
+	if (p == 0) {
+		return FALSE;
+	}
+	stat = atoi(p + 1);
+	coverage_registered = (stat == 1) || (stat == 5);
+	return TRUE;
+}
+
+
+
+/*
+ * coverage_good
+ */
+uint8_t coverage_good(uint8_t min_csq) {
+	return coverage_registered && (coverage_csq != COVERAGE_UNKNOWN) && 
+		(coverage_csq >= min_csq);
+}
+
+
+
+/*
+ * coverage_bucket
+ */
+uint8_t coverage_bucket(uint8_t csq) {
+	return (csq <= 31) ? csq / 8 : COVERAGE_BUCKETS - 1;
+}
+
+
+
+/*
+ * coverage_sent
+ */
+void coverage_sent(uint8_t ok, uint32_t latency) {
+	coverage_stat *stat = &coverage_stats[coverage_bucket(coverage_csq)];
+	if (ok) {
+		stat->sent++;
+		stat->latency_sum += latency;
+	}
+	else {
+		stat->failed++;
+	}
+}
@@ -0,0 +1,66 @@
+/* ----------------------------------------------------
+ * File    : coverage.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Network coverage from AT+CSQ and AT+CREG?, and statistics of
+ * the SMS sends by signal level.
+ */
+
+#ifndef COVERAGE_H_
+#define COVERAGE_H_
+
+#include <inttypes.h>
+
+// rssi of AT+CSQ, 0..31, 99 is unknown
+#define COVERAGE_UNKNOWN	99
+
+// csq 0-7, 8-15, 16-23, 24-31, unknown
+#define COVERAGE_BUCKETS	5
+
+typedef struct {
+	uint16_t sent;
+	uint16_t failed;
+	uint32_t latency_sum;	// ms, of the sent ones
+} coverage_stat;
+
+extern uint8_t coverage_csq;			// last sample
+extern uint8_t coverage_registered;		// TRUE if home or roaming
+extern uint16_t coverage_samples;
+extern coverage_stat coverage_stats[COVERAGE_BUCKETS];
+
+/*
+ * coverage_parse_csq
+ * Takes the rssi out of a "+CSQ: 17,0" response.
+ * return	uint8_t	TRUE if the response held it
+ */
+uint8_t coverage_parse_csq(const char *response);
+
+/*
+ * coverage_parse_creg
+ * Takes the registration out of a "+CREG: 0,1" response.
+ * return	uint8_t	TRUE if the response held it
+ */
+uint8_t coverage_parse_creg(const char *response);
+
+/*
+ * coverage_good
+ * return	uint8_t	TRUE if registered and the last csq is known and 
+ *					at least min_csq
+ */
+uint8_t coverage_good(uint8_t min_csq);
+
+/*
+ * coverage_bucket
+ * return	uint8_t	statistics bucket of a csq
+ */
+uint8_t coverage_bucket(uint8_t csq);
+
+/*
+ * coverage_sent
+ * Counts a send at the last sampled csq.
+ */
+void coverage_sent(uint8_t ok, uint32_t latency);
+
+#endif /*COVERAGE_H_*/
@@ -0,0 +1,148 @@
+/* ----------------------------------------------------
+ * File    : eeq.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Interrupt driven EEPROM write queue. The foreground puts
+ * address/value pairs into a ring buffer. The EE_RDY interrupt
+ * takes them out, compares them with the current EEPROM content
+ * and only programs bytes that have changed.
+ */
+
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include "eeq.h"
+#include "idle.h"
+#include "profile.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+#define EEQ_MASK ( EEQ_SIZE - 1 )
+#if ( EEQ_SIZE & EEQ_MASK )
+	#error EEQ buffer size is not a power of 2
+#endif
+
+
+static volatile uint16_t eeq_addr[EEQ_SIZE];
+static volatile uint8_t eeq_data[EEQ_SIZE];
+static volatile uint8_t eeq_head = 0;
+static volatile uint8_t eeq_tail = 0;
+
+volatile uint16_t eeq_written = 0;
+volatile uint16_t eeq_skipped = 0;
+
+
+
+/*
+ * eeq_write_byte
+ * Queues a single byte and enables the EEPROM ready interrupt.
+ */
+uint8_t eeq_write_byte(uint8_t *dst, uint8_t value) {
+	uint8_t tmp_head = 0;
+	tmp_head = (eeq_head + 1) & EEQ_MASK;
+	if (tmp_head == eeq_tail) {
+		return FALSE;		// full
+	}
+	eeq_addr[eeq_head] = (uint16_t)dst;
+	eeq_data[eeq_head] = value;
+	eeq_head = tmp_head;
+	// enable eeprom ready interrupt (start writing)
+	EECR |= (1 << EERIE);
+	return TRUE;
+}
+
+
+
+/*
+ * eeq_write_word
+ */
+void eeq_write_word(uint16_t *dst, uint16_t value) {
+	eeq_write_block(&value, dst, sizeof(value));
+}
+
+
+
+/*
+ * eeq_write_block
+ * The interrupt frees a slot at least every 8.5ms, the timer tick
+ * ends the sleep every ms.
+ */
+void eeq_write_block(const void *src, void *dst, uint8_t n) {
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	while (n) {
+		if (eeq_write_byte(d, *s)) {
+			d++;
+			s++;
+			n--;
+		}
+		else {
+			idle_sleep();
+			wdt_reset();
+		}
+	}
+}
+
+
+
+/*
+ * eeq_flush
+ * The interrupt disables itself only after the last write has
+ * completed, so waiting for EERIE covers both the queue and the
+ * write in progress.
+ */
+void eeq_flush(void) {
+	while (EECR & (1 << EERIE)) {
+		;
+	}
+}
+
+
+
+/*
+ * eeq_pending
+ */
+uint8_t eeq_pending(void) {
+	return (eeq_head - eeq_tail) & EEQ_MASK;
+}
+
+
+
+/*
+ * SIGNAL EEPROM ready
+ * Programs the next changed byte out of the queue. Unchanged
+ * bytes are skipped without a write cycle. If the queue is 
+ * empty, the interrupt gets disabled.
+ */
+SIGNAL(EE_RDY_vect) {
+	PROFILE_ENTER(PROFILE_EEPROM, PROFILE_NO_EVENT);
+	uint8_t tmp_tail = eeq_tail;
+	uint8_t data = 0;
+	while (eeq_head != tmp_tail) {
+		EEAR = eeq_addr[tmp_tail];
+		data = eeq_data[tmp_tail];
+		tmp_tail = (tmp_tail + 1) & EEQ_MASK;
+		EECR |= (1 << EERE);
+		if (EEDR != data) {
+			EEDR = data;
+			EECR |= (1 << EEMWE);
+			EECR |= (1 << EEWE);
+			eeq_written++;
+			eeq_tail = tmp_tail;
+			PROFILE_EXIT(PROFILE_EEPROM);
+			return;
+		}
+		eeq_skipped++;
+	}
+	eeq_tail = tmp_tail;
+	// disable this interrupt if nothing more to write
+	EECR &= ~(1 << EERIE);
+	PROFILE_EXIT(PROFILE_EEPROM);
+}
+
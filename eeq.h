@@ -0,0 +1,61 @@
+/* ----------------------------------------------------
+ * File    : eeq.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Interrupt driven EEPROM write queue. Writes are queued and
+ * programmed byte by byte from the EE_RDY interrupt, so the
+ * caller does not wait the ~8.5ms per byte.
+ */
+
+#ifndef EEQ_H_
+#define EEQ_H_
+
+#include <inttypes.h>
+
+// number of bytes which can be pending, must be a power of 2
+#define EEQ_SIZE 16
+
+/*
+ * eeq_write_byte
+ * Queues a single byte, never waits.
+ * return	uint8_t	FALSE if the queue is full and the byte was not queued
+ */
+uint8_t eeq_write_byte(uint8_t *dst, uint8_t value);
+
+/*
+ * eeq_write_word
+ * Queues a word, low byte first, see eeq_write_block().
+ */
+void eeq_write_word(uint16_t *dst, uint16_t value);
+
+/*
+ * eeq_write_block
+ * Queues a block of bytes. The source is copied, so it may be
+ * released right after the call. While the queue is full, it waits
+ * in idle sleep with the watchdog serviced. Unchanged bytes are
+ * skipped by the interrupt without a write cycle, so only changed
+ * bytes beyond EEQ_SIZE cost time, 8.5ms each. The worst case is a
+ * config that changed in every byte, about 0.5s.
+ */
+void eeq_write_block(const void *src, void *dst, uint8_t n);
+
+/*
+ * eeq_flush
+ * Barrier, waits until all queued bytes are programmed.
+ * Call it before reading EEPROM with the avr-libc functions.
+ */
+void eeq_flush(void);
+
+/*
+ * eeq_pending
+ * return	uint8_t	number of bytes waiting in the queue
+ */
+uint8_t eeq_pending(void);
+
+// statistics, bytes programmed and bytes skipped because unchanged
+extern volatile uint16_t eeq_written;
+extern volatile uint16_t eeq_skipped;
+
+#endif /*EEQ_H_*/
@@ -0,0 +1,112 @@
+/* ----------------------------------------------------
+ * File    : filter.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Plausibility filter for GPS fixes, see filter.h.
+ */
+
+#include <inttypes.h>
+#include "filter.h"
+#include "geofence.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+// a difference beyond this is a jump anyway, keeps the products in range
+#define MAX_DELTA	20000000L		// microdegrees, about 2200 km
+
+/*
+ * filter_reset
+ */
+void filter_reset(filter_state *state) {
+	state->valid = FALSE;
+	state->last.utc = 0;
+	state->rejects = 0;
+}
+
+
+
+/*
+ * filter_distance
+ * 1 microdegree of latitude is 0.111 m, of longitude 0.111 m * cos.
+ * The distance is max + min / 2 of the two legs.
+ */
+uint32_t filter_distance(const filter_fix *a, const filter_fix *b) {
+	int32_t dlat = a->lat - b->lat;
+	int32_t dlon = a->lon - b->lon;
+	uint32_t dy;
+	uint32_t dx;
+	if (dlat < 0) {
+		dlat = -dlat;
+	}
+	if (dlon < 0) {
+		dlon = -dlon;
+	}
+	if (dlat > MAX_DELTA) {
+		dlat = MAX_DELTA;
+	}
+	if (dlon > MAX_DELTA) {
+		dlon = MAX_DELTA;
+	}
+	dy = (uint32_t)dlat * 111 / 1000;
+	dx = ((uint32_t)dlon * 111 / 1000) * geofence_cos(a->lat) / 256;
+	return (dx > dy) ? dx + dy / 2 : dy + dx / 2;
+}
+
+
+
+/*
+ * filter_check
+ */
+uint8_t filter_check(filter_state *state, filter_fix *fix) {
+	filter_fix *last = &state->last;
+	uint32_t dt;
+	uint32_t distance;
+	uint32_t allowed;
+	uint8_t result = FILTER_OK;
+	if (fix->sats < FILTER_MIN_SATS) {
+		result = FILTER_SATS;
+	}
+	else if (fix->hdop > FILTER_MAX_HDOP) {
+		result = FILTER_HDOP;
+	}
+	else if ((fix->utc != 0) && (last->utc != 0) && (fix->utc <= last->utc)) {
+		result = FILTER_STALE;
+		if (state->valid && (++state->rejects > FILTER_MAX_REJECTS)) {
+			// maybe the last fix is wrong, a fix newer than this one
+			// starts again
+			state->valid = FALSE;
+			last->utc = fix->utc;
+		}
+	}
+	else if (state->valid) {
+		dt = fix->time - last->time;
+		if (dt > 86400L) {
+			dt = 86400L;
+		}
+		distance = filter_distance(fix, last);
+		allowed = FILTER_MAX_SPEED * dt + 
+			((uint16_t)fix->hdop + last->hdop) * FILTER_NOISE;
+		if ((distance > allowed) && (++state->rejects <= FILTER_MAX_REJECTS)) {
+			result = FILTER_JUMP;
+		}
+#ifdef FILTER_SMOOTH
+		else if ((dt <= FILTER_SMOOTH_TIME) && 
+				(distance <= ((uint16_t)fix->hdop + last->hdop) * FILTER_NOISE)) {
+			fix->lat = last->lat + (fix->lat - last->lat) / 2;
+			fix->lon = last->lon + (fix->lon - last->lon) / 2;
+		}
+#endif
+	}
+	state->count[result]++;
+	if (result == FILTER_OK) {
+		state->last = *fix;
+		state->valid = TRUE;
+		state->rejects = 0;
+	}
+	return result;
+}
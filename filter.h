@@ -0,0 +1,78 @@
+/* ----------------------------------------------------
+ * File    : filter.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Plausibility filter for GPS fixes. Each fix is compared with the
+ * last accepted one: it must be newer, have enough satellites and 
+ * a sane hdop, and must not imply a speed above FILTER_MAX_SPEED.
+ * The allowed distance includes the noise of both fixes. After
+ * FILTER_MAX_REJECTS jumps in a row the fix is taken, so a wrong last
+ * fix is not kept forever. A stale fix is never taken: after 
+ * FILTER_MAX_REJECTS in a row the last fix is dropped and the next 
+ * fix newer than the stale one is taken as it is.
+ * Integer only, no loops, so it runs in bounded time.
+ * With -DFILTER_SMOOTH, a fix close to the last one is averaged 
+ * with it.
+ */
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <inttypes.h>
+
+#define FILTER_MAX_SPEED	70		// m/s, 250 km/h
+#define FILTER_MIN_SATS		3
+#define FILTER_MAX_HDOP		60		// tenths
+#define FILTER_NOISE		2		// m per tenth of hdop
+#define FILTER_MAX_REJECTS	3		// stale fixes or jumps in a row, then
+									// a jump is taken, a stale fix drops
+									// the last fix
+#define FILTER_SMOOTH_TIME	10		// s, only fixes this close are averaged
+
+// results of filter_check(), also index of the counters
+#define FILTER_OK		0
+#define FILTER_STALE	1		// not newer than the last fix
+#define FILTER_SATS		2
+#define FILTER_HDOP		3
+#define FILTER_JUMP		4		// too fast from the last fix
+#define FILTER_RESULTS	5
+
+typedef struct {
+	int32_t lat;			// microdegrees
+	int32_t lon;
+	uint32_t utc;			// s, 0 if unknown
+	uint32_t time;			// s, of a clock that always runs
+	uint8_t hdop;			// tenths
+	uint8_t sats;
+} filter_fix;
+
+typedef struct {
+	filter_fix last;		// last accepted fix, or only the utc of
+							// the stale fix that dropped it
+	uint8_t valid;			// TRUE if there is one
+	uint8_t rejects;		// stale fixes or jumps in a row
+	uint16_t count[FILTER_RESULTS];
+} filter_state;
+
+/*
+ * filter_reset
+ * Forgets the last fix and its time, the counters are kept.
+ */
+void filter_reset(filter_state *state);
+
+/*
+ * filter_check
+ * Checks a fix, and with FILTER_SMOOTH may move it.
+ * return	uint8_t	FILTER_OK or the reason of the rejection
+ */
+uint8_t filter_check(filter_state *state, filter_fix *fix);
+
+/*
+ * filter_distance
+ * return	uint32_t	distance in m, within about 12%
+ */
+uint32_t filter_distance(const filter_fix *a, const filter_fix *b);
+
+#endif /*FILTER_H_*/
@@ -0,0 +1,213 @@
+/* ----------------------------------------------------
+ * File    : geofence.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Geofencing, see geofence.h.
+ * Circles are tested in meters, with the longitude scaled by the 
+ * cosine of the latitude. Polygons are tested by ray casting in 
+ * the lat/lon plane, no scaling is needed there.
+ */
+
+#include <inttypes.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include "geofence.h"
+#include "eeq.h"
+#include "pool.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+// positions further away are outside of any circle, in microdegrees
+#define MAX_DLAT 524288L		// 58km
+#define MAX_DLON 4194304L
+
+// cosine of 0, 5, .. 90 degrees, * 256
+static const uint16_t cos_P[] PROGMEM = {
+	256, 255, 252, 247, 241, 232, 222, 210, 196, 
+	181, 165, 147, 128, 108, 88, 66, 44, 22, 0 };
+
+geofence_zone geofence_ee[GEOFENCE_ZONES] EEMEM;
+
+static uint8_t state = 0;
+static uint8_t state_valid = FALSE;
+
+
+
+/*
+ * geofence_cos
+ */
+uint16_t geofence_cos(int32_t lat) {
+	uint8_t i;
+	int32_t frac;
+	int16_t c;
+	if (lat < 0) {
+		lat = -lat;
+	}
+	if (lat >= 90000000L) {
+		return 0;
+	}
+	i = lat / 5000000L;
+	frac = lat - i * 5000000L;
+	c = pgm_read_word(&cos_P[i]);
+	c += ((int16_t)pgm_read_word(&cos_P[i + 1]) - c) * frac / 5000000L;
+	return c;
+}
+
+
+
+/*
+ * Microdegrees of latitude to m, 1 microdegree is 0.1113m.
+ */
+static int32_t to_m(int32_t udeg) {
+	return (udeg * 57) / 512;
+}
+
+
+
+static uint8_t inside_circle(const geofence_zone *zone, int32_t lat, int32_t lon) {
+	int32_t dlat = lat - zone->lat;
+	int32_t dlon = lon - zone->lon;
+	int32_t r = zone->shape.radius;
+	int32_t x;
+	int32_t y;
+	if ((dlat > MAX_DLAT) || (dlat < -MAX_DLAT) || 
+			(dlon > MAX_DLON) || (dlon < -MAX_DLON)) {
+		return FALSE;
+	}
+	y = to_m(dlat);
+	x = to_m((dlon * geofence_cos(zone->lat)) / 256);
+	if ((x > r) || (x < -r) || (y > r) || (y < -r)) {
+		return FALSE;
+	}
+	return ((uint32_t)(x * x) + (uint32_t)(y * y)) <= (uint32_t)(r * r);
+}
+
+
+
+static uint8_t inside_polygon(const geofence_zone *zone, int32_t lat, int32_t lon) {
+	int32_t y = (lat - zone->lat) / GEOFENCE_UNIT;
+	int32_t x = (lon - zone->lon) / GEOFENCE_UNIT;
+	const int16_t (*v)[2] = zone->shape.vertex;
+	uint8_t inside = FALSE;
+	uint8_t i;
+	uint8_t j;
+	int32_t lhs;
+	int32_t rhs;
+	if ((y > GEOFENCE_MAX_OFFSET) || (y < -GEOFENCE_MAX_OFFSET) || 
+			(x > GEOFENCE_MAX_OFFSET) || (x < -GEOFENCE_MAX_OFFSET)) {
+		return FALSE;
+	}
+	// count the edges crossed by a ray from the position to the east
+	j = zone->count - 1;
+	for (i = 0; i < zone->count; i++) {
+		if ((v[i][0] > y) != (v[j][0] > y)) {
+			// x < xi + (xj - xi) * (y - yi) / (yj - yi), without division
+			lhs = (x - v[i][1]) * (int32_t)(v[j][0] - v[i][0]);
+			rhs = (int32_t)(v[j][1] - v[i][1]) * (y - v[i][0]);
+			if ((v[j][0] > v[i][0]) ? (lhs < rhs) : (lhs > rhs)) {
+				inside = !inside;
+			}
+		}
+		j = i;
+	}
+	return inside;
+}
+
+
+
+/*
+ * geofence_inside
+ */
+uint8_t geofence_inside(const geofence_zone *zone, int32_t lat, int32_t lon) {
+	if (zone->type == GEOFENCE_CIRCLE) {
+		return inside_circle(zone, lat, lon);
+	}
+	if ((zone->type == GEOFENCE_POLYGON) && (zone->count >= 3) && 
+			(zone->count <= GEOFENCE_VERTICES)) {
+		return inside_polygon(zone, lat, lon);
+	}
+	return FALSE;
+}
+
+
+
+/*
+ * geofence_valid
+ */
+uint8_t geofence_valid(const geofence_zone *zone) {
+	uint8_t i;
+	if (zone->type == GEOFENCE_NONE) {
+		return TRUE;
+	}
+	if (zone->type == GEOFENCE_CIRCLE) {
+		return zone->shape.radius <= GEOFENCE_MAX_RADIUS;
+	}
+	if ((zone->type != GEOFENCE_POLYGON) || (zone->count < 3) || 
+			(zone->count > GEOFENCE_VERTICES)) {
+		return FALSE;
+	}
+	for (i = 0; i < zone->count; i++) {
+		if ((zone->shape.vertex[i][0] > GEOFENCE_MAX_OFFSET) || 
+				(zone->shape.vertex[i][0] < -GEOFENCE_MAX_OFFSET) || 
+				(zone->shape.vertex[i][1] > GEOFENCE_MAX_OFFSET) || 
+				(zone->shape.vertex[i][1] < -GEOFENCE_MAX_OFFSET)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+
+/*
+ * geofence_read
+ */
+void geofence_read(uint8_t index, geofence_zone *zone) {
+	eeq_flush();
+	eeprom_read_block(zone, &geofence_ee[index], sizeof(geofence_zone));
+}
+
+
+
+/*
+ * geofence_write
+ */
+void geofence_write(uint8_t index, const geofence_zone *zone) {
+	eeq_write_block(zone, &geofence_ee[index], sizeof(geofence_zone));
+	state_valid = FALSE;
+}
+
+
+
+/*
+ * geofence_update
+ */
+uint8_t geofence_update(int32_t lat, int32_t lon, uint8_t *entered, uint8_t *left) {
+	geofence_zone *zone = (geofence_zone *)pool_acquire();
+	uint8_t inside = 0;
+	uint8_t i;
+	*entered = 0;
+	*left = 0;
+	if (!zone) {
+		return state;
+	}
+	for (i = 0; i < GEOFENCE_ZONES; i++) {
+		geofence_read(i, zone);
+		if (geofence_inside(zone, lat, lon)) {
+			inside |= (1 << i);
+		}
+	}
+	pool_release(zone);
+	if (state_valid) {
+		*entered = inside & ~state;
+		*left = state & ~inside;
+	}
+	state = inside;
+	state_valid = TRUE;
+	return inside;
+}
@@ -0,0 +1,81 @@
+/* ----------------------------------------------------
+ * File    : geofence.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Geofencing with circular and polygon zones kept in EEPROM. 
+ * Positions are given in microdegrees, all tests use integer 
+ * arithmetic only and take bounded time.
+ */
+
+#ifndef GEOFENCE_H_
+#define GEOFENCE_H_
+
+#include <inttypes.h>
+
+#define GEOFENCE_ZONES		4
+#define GEOFENCE_VERTICES	6
+
+// zone types, erased EEPROM (0xff) reads as no zone
+#define GEOFENCE_NONE		0
+#define GEOFENCE_CIRCLE		1
+#define GEOFENCE_POLYGON	2
+
+// polygon vertices are offsets to the origin in this unit of
+// microdegrees, about 1.1m, limited to +-GEOFENCE_MAX_OFFSET
+#define GEOFENCE_UNIT		10
+#define GEOFENCE_MAX_OFFSET	16383
+
+// max radius in m
+#define GEOFENCE_MAX_RADIUS	32767
+
+typedef struct {
+	uint8_t type;
+	uint8_t count;			// vertices of a polygon
+	int32_t lat;			// microdegrees, center or origin
+	int32_t lon;
+	union {
+		uint16_t radius;	// m
+		int16_t vertex[GEOFENCE_VERTICES][2];	// lat and lon offsets
+	} shape;
+} geofence_zone;
+
+/*
+ * geofence_cos
+ * return	uint16_t	cosine of the latitude in microdegrees, * 256
+ */
+uint16_t geofence_cos(int32_t lat);
+
+/*
+ * geofence_inside
+ * return	uint8_t	TRUE if the position is inside the zone
+ */
+uint8_t geofence_inside(const geofence_zone *zone, int32_t lat, int32_t lon);
+
+/*
+ * geofence_valid
+ * return	uint8_t	TRUE if the zone is well formed, checked before
+ *					it is stored
+ */
+uint8_t geofence_valid(const geofence_zone *zone);
+
+/*
+ * geofence_read, geofence_write
+ * Reads or queues a zone in EEPROM.
+ */
+void geofence_read(uint8_t index, geofence_zone *zone);
+void geofence_write(uint8_t index, const geofence_zone *zone);
+
+/*
+ * geofence_update
+ * Tests the position against all zones. The first call only sets 
+ * the state. Without a free pool buffer for the zone, nothing is 
+ * tested and the last state is returned.
+ * entered	zones entered since the last call, bit 0 is zone 0
+ * left		zones left since the last call
+ * return	uint8_t	zones the position is in
+ */
+uint8_t geofence_update(int32_t lat, int32_t lon, uint8_t *entered, uint8_t *left);
+
+#endif /*GEOFENCE_H_*/
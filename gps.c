@@ -0,0 +1,165 @@
+/* ----------------------------------------------------
+ * File    : gps.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Parser for the $GPSACP response, see gps.h.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gps.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+#define IS_DIGIT(c) (((c) >= '0') && ((c) <= '9'))
+
+
+
+/*
+ * gps_skip
+ */
+char *gps_skip(char *str, char match) {
+	while (*str != '\0') {
+		if (*str++ == match) {
+			break;
+		}
+	}
+	return str;
+}
+
+
+
+/*
+ * gps_token
+ */
+char *gps_token(char *str, char *buf, uint8_t size, char delimiter) {
+	uint8_t c = 0;
+	uint8_t i = 0;
+	while ((c = *str) != '\0') {
+		str++;
+		if (c == delimiter) {
+			break;
+		}
+		else if ((c != ' ') && (i < size - 1)) {
+			buf[i++] = c;
+		}
+	}
+	buf[i] = '\0';
+	return str;
+}
+
+
+
+/*
+ * gps_split
+ */
+uint8_t gps_split(char *msg, gps_fields *f) {
+	msg = gps_skip(msg, ':');						// skip prolog
+	msg = gps_token(msg, f->time, sizeof(f->time), '.');	// time, hhmmss
+	msg = gps_token(msg, f->ms, sizeof(f->ms), ',');		// ms
+	msg = gps_token(msg, f->lat, sizeof(f->lat), ',');		// latitude
+	msg = gps_token(msg, f->lon, sizeof(f->lon), ',');		// longitude
+	msg = gps_token(msg, f->hdop, sizeof(f->hdop), ',');	// hdop
+	msg = gps_token(msg, f->alt, sizeof(f->alt), ',');		// altitude
+	msg = gps_token(msg, f->fix, sizeof(f->fix), ',');		// fix, 0, 2d, 3d
+	msg = gps_skip(msg, ',');						// cog, cource over ground
+	msg = gps_skip(msg, ',');						// speed [km]
+	msg = gps_skip(msg, ',');						// speed [kn]
+	msg = gps_token(msg, f->date, sizeof(f->date), ',');	// date ddmmyy
+	gps_token(msg, f->sats, sizeof(f->sats), '\r');		// number of sats
+	return (f->lat[0] != '\0') && (f->lon[0] != '\0') && 
+		(f->fix[0] != '\0') && (f->sats[0] != '\0');
+}
+
+
+
+/*
+ * gps_degrees
+ */
+uint8_t gps_degrees(const char *str, uint8_t *degree, uint32_t *millionths) {
+	const char *dot = strchr(str, '.');
+	uint32_t minutes = 0;	// 1/10000 minutes
+	uint16_t degrees = 0;
+	uint8_t i;
+
+	*degree = 0;
+	*millionths = 0;
+	// 2 or 3 digits for the degrees, 2 for the minutes
+	if ((dot == 0) || (dot - str < 3) || (dot - str > 5)) {
+		return FALSE;
+	}
+	for (; str < dot - 2; str++) {
+		if (!IS_DIGIT(*str)) {
+			return FALSE;
+		}
+		degrees = degrees * 10 + (*str - '0');
+	}
+	if (degrees > 180) {
+		return FALSE;
+	}
+	for (i = 0; i < 6; i++) {
+		if (*str == '.') {
+			str++;
+		}
+		if (IS_DIGIT(*str)) {
+			minutes = minutes * 10 + (*str++ - '0');
+		}
+		else if (i < 2) {
+			return FALSE;
+		}
+		else {
+			minutes *= 10;		// less than 4 decimals
+		}
+	}
+	if (minutes >= 600000L) {
+		return FALSE;
+	}
+	*degree = degrees;
+	// 1/10000 minutes to millionths of a degree
+	*millionths = minutes * 5 / 3;
+	return TRUE;
+}
+
+
+
+/*
+ * gps_hdop
+ */
+uint8_t gps_hdop(const char *str) {
+	uint16_t hdop = atoi(str) * 10;
+	const char *tenths = strchr(str, '.');
+	if (tenths && IS_DIGIT(tenths[1])) {
+		hdop += tenths[1] - '0';
+	}
+	return (hdop < 255) ? hdop : 255;
+}
+
+
+
+/*
+ * gps_2digits
+ */
+uint8_t gps_2digits(const char *str) {
+	return (str[0] - '0') * 10 + (str[1] - '0');
+}
+
+
+
+/*
+ * gps_position_of
+ */
+uint8_t gps_position_of(gps_fields *f, gps_position *pos) {
+	if (!gps_degrees(f->lat, &pos->lat_deg, &pos->lat_min) || 
+			!gps_degrees(f->lon, &pos->lon_deg, &pos->lon_min)) {
+		return FALSE;
+	}
+	pos->alt = atol(f->alt);
+	pos->fix = f->fix[0];
+	return TRUE;
+}
@@ -0,0 +1,93 @@
+/* ----------------------------------------------------
+ * File    : gps.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Parser for the $GPSACP response of the GM862. The parser only
+ * uses the C library, all reads and writes are bounded, so it can
+ * be fed with any input, also on a host.
+ */
+
+#ifndef GPS_H_
+#define GPS_H_
+
+#include <inttypes.h>
+
+typedef struct {
+	uint8_t lat_deg;
+	uint32_t lat_min;	// millionths of a degree
+	uint8_t lon_deg;
+	uint32_t lon_min;	// millionths of a degree
+	int32_t alt;
+	uint8_t fix;
+	uint32_t utc;		// seconds since 2000, 0 if unknown
+} gps_position;
+
+// the fields of a $GPSACP response, as strings
+typedef struct {
+	char time[7];		// hhmmss
+	char ms[4];
+	char lat[12];		// ddmm.mmmmN
+	char lon[12];		// dddmm.mmmmE
+	char hdop[6];
+	char alt[7];
+	char fix[2];		// 0, 2 (2d), 3 (3d)
+	char date[7];		// ddmmyy
+	char sats[4];
+} gps_fields;
+
+/*
+ * gps_skip
+ * return	char*	pointer behind the next match, or to the end of the
+ *					string, never behind it
+ */
+char *gps_skip(char *str, char match);
+
+/*
+ * gps_token
+ * Copies the string up to the delimiter into buf, without blanks.
+ * Chars that do not fit are dropped.
+ * return	char*	pointer behind the delimiter, or to the end of the 
+ *					string
+ */
+char *gps_token(char *str, char *buf, uint8_t size, char delimiter);
+
+/*
+ * gps_split
+ * Splits the response into its fields.
+ * example:
+ * $GPSACP: 120631.999,5433.9472N,00954.8768E,1.0,46.5,3,167.28,0.36,0.19,130707,11
+ * return	uint8_t	TRUE if all fields were found
+ */
+uint8_t gps_split(char *msg, gps_fields *fields);
+
+/*
+ * gps_degrees
+ * Converts degrees and minutes into degrees and millionths.
+ * Example: 5333.9472N --> 53 degrees, 33.9472 minutes --> 53.565787
+ * return	uint8_t	TRUE if the string was well formed, with at most
+ *					180 degrees
+ */
+uint8_t gps_degrees(const char *str, uint8_t *degree, uint32_t *millionths);
+
+/*
+ * gps_hdop
+ * return	uint8_t	the hdop in tenths, 1.0 --> 10, 255 if larger
+ */
+uint8_t gps_hdop(const char *str);
+
+/*
+ * gps_2digits
+ * return	uint8_t	value of two decimal digits
+ */
+uint8_t gps_2digits(const char *str);
+
+/*
+ * gps_position_of
+ * Fills the position from the fields, not the utc.
+ * return	uint8_t	TRUE if latitude and longitude were well formed
+ */
+uint8_t gps_position_of(gps_fields *fields, gps_position *pos);
+
+#endif /*GPS_H_*/
@@ -0,0 +1,706 @@
+/* ----------------------------------------------------
+ * File    : beaconctl.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host side client for the binary protocol of the beacon, see 
+ * proto.h. Talks to the soft UART (9600 8N1).
+ *
+ * Usage:
+ *   beaconctl [-p port] [-b baud] status
+ *   beaconctl [-p port] [-b baud] config [name=value ...]
+ *   beaconctl [-p port] [-b baud] log [first]
+ *   beaconctl [-p port] [-b baud] zone [index none|circle lat lon radius|
+ *                                       polygon lat lon lat lon lat lon ...]
+ *   beaconctl [-p port] [-b baud] capture [on|off]
+ *   beaconctl [-p port] [-b baud] replay file
+ *
+ * capture dumps the modem traffic recorded by a firmware built with
+ * UART_CAPTURE, one byte per line: ms, R (from modem) or T (to the 
+ * modem), hex value. The times have the 4ms resolution of the timer
+ * tick of the firmware, the bytes within a tick get the same time.
+ * The firmware stops the capture when a command fails for good, a 
+ * dump shows the last 110 or so chars before the failure; capture 
+ * on starts it again. replay plays the R bytes of such a dump with 
+ * their timing on a port, in place of the modem. The port starts at
+ * the rate given with -b, default 19200 like the firmware, and
+ * follows the AT+IPR commands of the capture: after the OK to one,
+ * it switches to the new rate, as the modem does.
+ * -b also sets the rate for the other commands, default 9600.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+
+#define PROTO_SOF			0xa5
+#define PROTO_MAX_PAYLOAD	80
+#define PROTO_REPLY			0x80
+#define PROTO_STATUS		0x01
+#define PROTO_CONFIG_READ	0x02
+#define PROTO_CONFIG_WRITE	0x03
+#define PROTO_LOG_READ		0x04
+#define PROTO_ZONE_READ		0x05
+#define PROTO_ZONE_WRITE	0x06
+#define PROTO_CAPTURE		0x07
+#define PROTO_CAPTURE_READ	0x08
+#define PROTO_NAK			0x7f
+
+// layout of the records as sent by the ATmega8, packed, little endian
+#define CONFIG_VERSION		8
+#define CONFIG_SIZE			74
+#define STATUS_SIZE			34
+#define LOG_RECORD_SIZE		18
+
+// must match geofence_zone in geofence.h
+#define ZONES				4
+#define ZONE_SIZE			34
+#define ZONE_VERTICES		6
+#define ZONE_NONE			0
+#define ZONE_CIRCLE			1
+#define ZONE_POLYGON		2
+#define ZONE_UNIT			10		// microdegrees
+#define ZONE_MAX_OFFSET		16383
+
+// must match capture.h
+#define CAPTURE_TX			0x40
+#define CAPTURE_MARK		0x80
+#define CAPTURE_TICKS		0x3f
+#define CAPTURE_GAP			0x3f
+#define CAPTURE_TICK_MS		4
+
+#define FIELD_STR	0
+#define FIELD_U8	1
+#define FIELD_U16	2
+
+typedef struct {
+	const char *name;
+	uint8_t offset;
+	uint8_t type;
+	uint8_t size;
+} config_field;
+
+// must match beacon_config in config.h
+static const config_field fields[] = {
+	{"pin", 1, FIELD_STR, 9},
+	{"gateway", 10, FIELD_STR, 16},
+	{"interval", 26, FIELD_U16, 2},
+	{"transport", 28, FIELD_U8, 1},
+	{"min_fix", 29, FIELD_U8, 1},
+	{"max_hdop", 30, FIELD_U8, 1},
+	{"smsc", 31, FIELD_STR, 16},
+	{"report_mode", 47, FIELD_U8, 1},
+	{"nofix_timeout", 48, FIELD_U16, 2},
+	{"min_csq", 50, FIELD_U8, 1},
+	{"max_defer", 51, FIELD_U16, 2},
+	{"modem_rate", 53, FIELD_U8, 1},
+	{"fix_budget", 54, FIELD_U16, 2},
+	{"master", 56, FIELD_STR, 16},
+	{0, 0, 0, 0}
+};
+
+static int fd = -1;
+
+
+
+static uint16_t crc16_update(uint16_t crc, uint8_t a) {
+	int i;
+	crc ^= a;
+	for (i = 0; i < 8; i++) {
+		if (crc & 1) {
+			crc = (crc >> 1) ^ 0xa001;
+		}
+		else {
+			crc = (crc >> 1);
+		}
+	}
+	return crc;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+	put_u16(p, v & 0xffff);
+	put_u16(p + 2, v >> 16);
+}
+
+static int32_t to_udeg(const char *degrees) {
+	return (int32_t)lround(strtod(degrees, 0) * 1000000.0);
+}
+
+
+
+/*
+ * Opens the serial port, 8N1, raw.
+ */
+static int open_port(const char *port, speed_t speed) {
+	struct termios tio;
+	fd = open(port, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		perror(port);
+		return -1;
+	}
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 10;		// 1s
+	tcsetattr(fd, TCSANOW, &tio);
+	tcflush(fd, TCIOFLUSH);
+	return 0;
+}
+
+/*
+ * The termios speed of a baud rate, 0 if there is none.
+ */
+static speed_t speed_of(long baud) {
+	switch (baud) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+	}
+	return 0;
+}
+
+static int set_speed(speed_t speed) {
+	struct termios tio;
+	tcdrain(fd);
+	tcgetattr(fd, &tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	return tcsetattr(fd, TCSANOW, &tio);
+}
+
+static int read_byte(void) {
+	uint8_t c;
+	if (read(fd, &c, 1) != 1) {
+		return -1;
+	}
+	return c;
+}
+
+
+
+/*
+ * Sends a frame.
+ */
+static void send_frame(uint8_t command, const uint8_t *payload, uint8_t length) {
+	uint8_t frame[PROTO_MAX_PAYLOAD + 5];
+	uint16_t crc = 0xffff;
+	int i;
+	frame[0] = PROTO_SOF;
+	frame[1] = length;
+	frame[2] = command;
+	memcpy(frame + 3, payload, length);
+	for (i = 1; i < length + 3; i++) {
+		crc = crc16_update(crc, frame[i]);
+	}
+	frame[length + 3] = crc & 0xff;
+	frame[length + 4] = crc >> 8;
+	if (write(fd, frame, length + 5) != length + 5) {
+		perror("write");
+	}
+}
+
+
+
+/*
+ * Receives a frame. Text output of the beacon before the SOF is
+ * skipped.
+ * return	int	length of the payload or -1
+ */
+static int receive_frame(uint8_t *command, uint8_t *payload) {
+	uint16_t crc = 0xffff;
+	int c;
+	int length;
+	int i;
+	while ((c = read_byte()) != PROTO_SOF) {
+		if (c == -1) {
+			fprintf(stderr, "timeout\n");
+			return -1;
+		}
+	}
+	length = read_byte();
+	c = read_byte();
+	if ((length < 0) || (length > PROTO_MAX_PAYLOAD) || (c < 0)) {
+		fprintf(stderr, "bad frame\n");
+		return -1;
+	}
+	*command = c;
+	crc = crc16_update(crc16_update(crc, length), c);
+	for (i = 0; i < length + 2; i++) {
+		if ((c = read_byte()) < 0) {
+			fprintf(stderr, "timeout\n");
+			return -1;
+		}
+		if (i < length) {
+			payload[i] = c;
+		}
+		crc = crc16_update(crc, c);
+	}
+	if (crc != 0) {
+		fprintf(stderr, "crc error\n");
+		return -1;
+	}
+	if (*command == (PROTO_NAK | PROTO_REPLY)) {
+		fprintf(stderr, "nak %d\n", payload[0]);
+		return -1;
+	}
+	return length;
+}
+
+
+
+/*
+ * Sends a request and waits for the reply.
+ */
+static int request(uint8_t command, const uint8_t *out, uint8_t out_length, 
+		uint8_t *payload) {
+	uint8_t reply;
+	int length;
+	send_frame(command, out, out_length);
+	length = receive_frame(&reply, payload);
+	if ((length >= 0) && (reply != (command | PROTO_REPLY))) {
+		fprintf(stderr, "unexpected reply %02x\n", reply);
+		return -1;
+	}
+	return length;
+}
+
+
+
+static void print_position(const uint8_t *p) {
+	// lat_deg, lat_min, lon_deg, lon_min
+	printf("%d.%06u,%d.%06u", p[0], get_u32(p + 1), p[5], get_u32(p + 6));
+}
+
+static int cmd_status(void) {
+	uint8_t p[PROTO_MAX_PAYLOAD];
+	if (request(PROTO_STATUS, 0, 0, p) != STATUS_SIZE) {
+		return 1;
+	}
+	printf("protocol: %d\n", p[0]);
+	printf("reboots: %u\n", get_u16(p + 1));
+	printf("uptime: %u s\n", get_u32(p + 3));
+	printf("utc: %u\n", get_u32(p + 7));
+	printf("mode: %d\n", p[11]);
+	printf("modem: %d\n", p[12]);
+	printf("cpu: %d%%\n", p[13]);
+	printf("log: %d records\n", p[14]);
+	printf("position: ");
+	print_position(p + 15);
+	printf(" alt %d fix %c utc %u\n", (int32_t)get_u32(p + 25), 
+		p[29] ? p[29] : '-', get_u32(p + 30));
+	return 0;
+}
+
+
+
+static const config_field *find_field(const char *name, size_t length) {
+	const config_field *f;
+	for (f = fields; f->name; f++) {
+		if ((strlen(f->name) == length) && !strncmp(f->name, name, length)) {
+			return f;
+		}
+	}
+	return 0;
+}
+
+static int cmd_config(int argc, char **argv) {
+	uint8_t p[PROTO_MAX_PAYLOAD];
+	const config_field *f;
+	char *value;
+	int i;
+	if (request(PROTO_CONFIG_READ, 0, 0, p) != CONFIG_SIZE) {
+		return 1;
+	}
+	if (p[0] != CONFIG_VERSION) {
+		fprintf(stderr, "config version %d not supported\n", p[0]);
+		return 1;
+	}
+	if (argc > 0) {
+		for (i = 0; i < argc; i++) {
+			value = strchr(argv[i], '=');
+			if (!value || !(f = find_field(argv[i], value - argv[i]))) {
+				fprintf(stderr, "unknown setting %s\n", argv[i]);
+				return 1;
+			}
+			value++;
+			if (f->type == FIELD_STR) {
+				memset(p + f->offset, 0, f->size);
+				strncpy((char *)p + f->offset, value, f->size - 1);
+			}
+			else {
+				unsigned long v = strtoul(value, 0, 0);
+				p[f->offset] = v & 0xff;
+				if (f->type == FIELD_U16) {
+					p[f->offset + 1] = v >> 8;
+				}
+			}
+		}
+		if (request(PROTO_CONFIG_WRITE, p, CONFIG_SIZE, p) != CONFIG_SIZE) {
+			return 1;
+		}
+	}
+	for (f = fields; f->name; f++) {
+		if (f->type == FIELD_STR) {
+			printf("%s=%.*s\n", f->name, f->size, (char *)p + f->offset);
+		}
+		else if (f->type == FIELD_U16) {
+			printf("%s=%u\n", f->name, get_u16(p + f->offset));
+		}
+		else {
+			printf("%s=%u\n", f->name, p[f->offset]);
+		}
+	}
+	return 0;
+}
+
+
+
+static int cmd_log(uint8_t first) {
+	uint8_t p[PROTO_MAX_PAYLOAD];
+	uint8_t reply;
+	int length;
+	int i;
+	send_frame(PROTO_LOG_READ, &first, 1);
+	printf("seq,utc,lat,lon,alt\n");
+	while ((length = receive_frame(&reply, p)) > 0) {
+		if (reply != (PROTO_LOG_READ | PROTO_REPLY)) {
+			fprintf(stderr, "unexpected reply %02x\n", reply);
+			return 1;
+		}
+		for (i = 0; i + LOG_RECORD_SIZE <= length; i += LOG_RECORD_SIZE) {
+			printf("%u,%u,", get_u16(p + i), get_u32(p + i + 2));
+			print_position(p + i + 6);
+			printf(",%d\n", (int16_t)get_u16(p + i + 16));
+		}
+	}
+	return (length == 0) ? 0 : 1;
+}
+
+
+
+/*
+ * Prints a zone, layout: type, count, lat, lon, then the radius or 
+ * the vertices as lat/lon offsets.
+ */
+static void print_zone(const uint8_t *p) {
+	int32_t lat = get_u32(p + 3);
+	int32_t lon = get_u32(p + 7);
+	int i;
+	printf("%d ", p[0]);
+	if (p[1] == ZONE_CIRCLE) {
+		printf("circle %.6f %.6f %u\n", lat / 1e6, lon / 1e6, get_u16(p + 11));
+	}
+	else if (p[1] == ZONE_POLYGON) {
+		printf("polygon");
+		for (i = 0; (i < p[2]) && (i < ZONE_VERTICES); i++) {
+			printf(" %.6f %.6f", 
+				(lat + (int16_t)get_u16(p + 11 + i * 4) * ZONE_UNIT) / 1e6,
+				(lon + (int16_t)get_u16(p + 13 + i * 4) * ZONE_UNIT) / 1e6);
+		}
+		printf("\n");
+	}
+	else {
+		printf("none\n");
+	}
+}
+
+static int cmd_zone(int argc, char **argv) {
+	uint8_t p[PROTO_MAX_PAYLOAD];
+	uint8_t *zone = p + 1;
+	int32_t lat;
+	int32_t lon;
+	long offset;
+	int i;
+	if (argc == 0) {
+		for (i = 0; i < ZONES; i++) {
+			p[0] = i;
+			if (request(PROTO_ZONE_READ, p, 1, p) != ZONE_SIZE + 1) {
+				return 1;
+			}
+			print_zone(p);
+		}
+		return 0;
+	}
+	memset(p, 0, sizeof(p));
+	p[0] = atoi(argv[0]);
+	if ((argc == 2) && !strcmp(argv[1], "none")) {
+		zone[0] = ZONE_NONE;
+	}
+	else if ((argc == 5) && !strcmp(argv[1], "circle")) {
+		zone[0] = ZONE_CIRCLE;
+		put_u32(zone + 2, to_udeg(argv[2]));
+		put_u32(zone + 6, to_udeg(argv[3]));
+		put_u16(zone + 10, atoi(argv[4]));
+	}
+	else if ((argc >= 8) && (argc <= 2 + 2 * ZONE_VERTICES) && 
+			!(argc & 1) && !strcmp(argv[1], "polygon")) {
+		// the first vertex is the origin
+		lat = to_udeg(argv[2]);
+		lon = to_udeg(argv[3]);
+		zone[0] = ZONE_POLYGON;
+		zone[1] = (argc - 2) / 2;
+		put_u32(zone + 2, lat);
+		put_u32(zone + 6, lon);
+		for (i = 0; i < zone[1]; i++) {
+			offset = lround((to_udeg(argv[2 + 2 * i]) - lat) / (double)ZONE_UNIT);
+			if (labs(offset) > ZONE_MAX_OFFSET) {
+				fprintf(stderr, "vertex %d too far from the first one\n", i);
+				return 1;
+			}
+			put_u16(zone + 10 + i * 4, offset);
+			offset = lround((to_udeg(argv[3 + 2 * i]) - lon) / (double)ZONE_UNIT);
+			if (labs(offset) > ZONE_MAX_OFFSET) {
+				fprintf(stderr, "vertex %d too far from the first one\n", i);
+				return 1;
+			}
+			put_u16(zone + 12 + i * 4, offset);
+		}
+	}
+	else {
+		fprintf(stderr, "bad zone\n");
+		return 1;
+	}
+	if (request(PROTO_ZONE_WRITE, p, ZONE_SIZE + 1, p) != ZONE_SIZE + 1) {
+		return 1;
+	}
+	print_zone(p);
+	return 0;
+}
+
+
+
+/*
+ * Decodes a byte of the capture ring, see capture.h. The state is
+ * kept over the frames, a mark and its byte may be split.
+ */
+static void decode_capture(uint8_t c) {
+	static uint32_t ms = 0;
+	static char dir = 'R';
+	static int gap_bytes = 0;		// ticks of a pause still to come
+	static uint16_t gap = 0;
+	static int marked = 0;			// byte of a mark comes next
+	if (gap_bytes == 2) {
+		gap = c;
+		gap_bytes--;
+		return;
+	}
+	if (gap_bytes == 1) {
+		ms += (gap | (c << 8)) * CAPTURE_TICK_MS;
+		gap_bytes--;
+		return;
+	}
+	if (!marked && (c & CAPTURE_MARK)) {
+		dir = (c & CAPTURE_TX) ? 'T' : 'R';
+		if ((c & CAPTURE_TICKS) == CAPTURE_GAP) {
+			gap_bytes = 2;
+		}
+		else {
+			ms += (c & CAPTURE_TICKS) * CAPTURE_TICK_MS;
+		}
+		marked = 1;
+		return;
+	}
+	marked = 0;
+	printf("%u %c %02x\n", ms, dir, c);
+}
+
+
+
+static int cmd_capture(int argc, char **argv) {
+	uint8_t p[PROTO_MAX_PAYLOAD];
+	uint8_t reply;
+	int length;
+	int i;
+	if (argc > 0) {
+		p[0] = !strcmp(argv[0], "on");
+		if (request(PROTO_CAPTURE, p, 1, p) != 1) {
+			return 1;
+		}
+		printf("%d bytes\n", p[0]);
+		return 0;
+	}
+	send_frame(PROTO_CAPTURE_READ, 0, 0);
+	printf("# ms dir byte\n");
+	while ((length = receive_frame(&reply, p)) > 0) {
+		if (reply != (PROTO_CAPTURE_READ | PROTO_REPLY)) {
+			fprintf(stderr, "unexpected reply %02x\n", reply);
+			return 1;
+		}
+		for (i = 0; i < length; i++) {
+			decode_capture(p[i]);
+		}
+	}
+	return (length == 0) ? 0 : 1;
+}
+
+
+
+static uint32_t now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Collects the chars of a direction into a line, returns the line
+ * when it ends with CR or LF, else 0.
+ */
+static const char *collect(char *buf, int size, int *n, uint8_t c) {
+	if ((c == '\r') || (c == '\n')) {
+		buf[*n] = '\0';
+		*n = 0;
+		return buf;
+	}
+	if (*n < size - 1) {
+		buf[(*n)++] = c;
+	}
+	return 0;
+}
+
+/*
+ * Plays the modem side of a capture on the port. The rate of the 
+ * port follows the AT+IPR commands sent by the beacon.
+ */
+static int cmd_replay(const char *file) {
+	FILE *in = fopen(file, "r");
+	char line[80];
+	char sent[32];
+	char received[32];
+	int n_sent = 0;
+	int n_received = 0;
+	const char *done;
+	long ipr = 0;
+	unsigned ms;
+	char dir;
+	unsigned value;
+	uint8_t c;
+	uint32_t start = now_ms();
+	uint32_t now;
+	if (!in) {
+		perror(file);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "%u %c %x", &ms, &dir, &value) != 3) {
+			continue;
+		}
+		if (dir == 'T') {
+			done = collect(sent, sizeof(sent), &n_sent, value);
+			if (done && !strncmp(done, "AT+IPR=", 7)) {
+				ipr = atol(done + 7);
+			}
+			continue;
+		}
+		if (dir != 'R') {
+			continue;
+		}
+		while ((now = now_ms() - start) < ms) {
+			usleep((ms - now) * 1000);
+		}
+		c = value;
+		if (write(fd, &c, 1) != 1) {
+			perror("write");
+			fclose(in);
+			return 1;
+		}
+		done = collect(received, sizeof(received), &n_received, c);
+		if (done && ipr && (!strcmp(done, "OK") || !strcmp(done, "ERROR"))) {
+			if (!strcmp(done, "OK") && speed_of(ipr)) {
+				set_speed(speed_of(ipr));
+				fprintf(stderr, "%u ms: %ld baud\n", ms, ipr);
+			}
+			ipr = 0;
+		}
+	}
+	fclose(in);
+	return 0;
+}
+
+
+
+static void usage(void) {
+	fprintf(stderr, 
+		"usage: beaconctl [-p port] [-b baud] status\n"
+		"       beaconctl [-p port] [-b baud] config [name=value ...]\n"
+		"       beaconctl [-p port] [-b baud] log [first]\n"
+		"       beaconctl [-p port] [-b baud] zone [index none|circle lat lon radius|\n"
+		"                                           polygon lat lon lat lon lat lon ...]\n"
+		"       beaconctl [-p port] [-b baud] capture [on|off]\n"
+		"       beaconctl [-p port] [-b baud] replay file\n");
+}
+
+int main(int argc, char **argv) {
+	const char *port = "/dev/ttyS0";
+	long baud = 0;
+	int result = 1;
+	while ((argc > 2) && (argv[1][0] == '-')) {
+		if (!strcmp(argv[1], "-p")) {
+			port = argv[2];
+		}
+		else if (!strcmp(argv[1], "-b") && speed_of(atol(argv[2]))) {
+			baud = atol(argv[2]);
+		}
+		else {
+			usage();
+			return 1;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+	if (baud == 0) {
+		baud = strcmp(argv[1], "replay") ? 9600 : 19200;
+	}
+	if (open_port(port, speed_of(baud))) {
+		return 1;
+	}
+	if (!strcmp(argv[1], "status")) {
+		result = cmd_status();
+	}
+	else if (!strcmp(argv[1], "config")) {
+		result = cmd_config(argc - 2, argv + 2);
+	}
+	else if (!strcmp(argv[1], "log")) {
+		result = cmd_log((argc > 2) ? atoi(argv[2]) : 0);
+	}
+	else if (!strcmp(argv[1], "zone")) {
+		result = cmd_zone(argc - 2, argv + 2);
+	}
+	else if (!strcmp(argv[1], "capture")) {
+		result = cmd_capture(argc - 2, argv + 2);
+	}
+	else if ((argc > 2) && !strcmp(argv[1], "replay")) {
+		result = cmd_replay(argv[2]);
+	}
+	else {
+		usage();
+	}
+	close(fd);
+	return result;
+}
@@ -0,0 +1,125 @@
+/* ----------------------------------------------------
+ * File    : filtertest.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host test of the fix filter in filter.c. Short tracks of fixes
+ * are checked fix by fix against the result filter_check() has to
+ * give: a GPS that repeats the same time must never get a fix
+ * through, a wrong last fix with a time ahead is dropped after
+ * FILTER_MAX_REJECTS stale fixes, jumps are taken after as many,
+ * and fixes with too few satellites or a bad hdop are rejected.
+ *
+ * Usage:
+ *   filtertest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "filter.h"
+#include "eeq.h"
+
+#define UTC		237643200L		// 2007-07-13 12:00:00
+
+static const char *names[FILTER_RESULTS] = {
+	"ok", "stale", "sats", "hdop", "jump"
+};
+
+static int failures = 0;
+static int checked = 0;
+
+
+
+/*
+ * geofence.c gives the cosine for the distance, the zones it keeps
+ * in the EEPROM are not used.
+ */
+void eeq_write_block(const void *src, void *dst, uint8_t n) {
+	memcpy(dst, src, n);
+}
+
+void eeq_flush(void) {
+}
+
+
+
+/*
+ * Checks a fix of a track. lat is given in m north of the start,
+ * time is s since the start, utc is s after UTC or 0 if unknown.
+ */
+static void check(const char *track, filter_state *state, int32_t lat,
+		uint32_t time, uint32_t utc, uint8_t hdop, uint8_t sats,
+		uint8_t expected) {
+	filter_fix fix;
+	uint8_t result;
+	fix.lat = 53565786L + lat * 9;		// about 0.111 m per microdegree
+	fix.lon = 9914613L;
+	fix.time = time;
+	fix.utc = utc ? UTC + utc : 0;
+	fix.hdop = hdop;
+	fix.sats = sats;
+	result = filter_check(state, &fix);
+	checked++;
+	if (result != expected) {
+		printf("FAIL %s, fix %d: %s, expected %s\n", track, checked,
+			names[result], names[expected]);
+		failures++;
+	}
+}
+
+
+
+int main(void) {
+	filter_state state;
+	int i;
+
+	// the GPS repeats the same fix, none but the first gets through
+	memset(&state, 0, sizeof(state));
+	check("same time", &state, 0, 0, 10, 12, 7, FILTER_OK);
+	for (i = 1; i <= 3 * FILTER_MAX_REJECTS; i++) {
+		check("same time", &state, 0, i, 10, 12, 7, FILTER_STALE);
+	}
+	check("same time", &state, 100, 20, 20, 12, 7, FILTER_OK);
+	check("same time", &state, 200, 30, 30, 12, 7, FILTER_OK);
+
+	// the first fix has a time far ahead, the others are stale to it
+	memset(&state, 0, sizeof(state));
+	check("time ahead", &state, 0, 0, 86400, 12, 7, FILTER_OK);
+	for (i = 1; i <= FILTER_MAX_REJECTS + 1; i++) {
+		check("time ahead", &state, i * 100, i * 10, i * 10, 12, 7,
+			FILTER_STALE);
+	}
+	// older than the stale fix that dropped the last one
+	check("time ahead", &state, 500, 50, (FILTER_MAX_REJECTS + 1) * 10,
+		12, 7, FILTER_STALE);
+	// a newer one is taken, however far it is from the dropped fix
+	check("time ahead", &state, 50000, 60, 100, 12, 7, FILTER_OK);
+	check("time ahead", &state, 50700, 70, 110, 12, 7, FILTER_OK);
+
+	// a jump is rejected FILTER_MAX_REJECTS times, then taken
+	memset(&state, 0, sizeof(state));
+	check("jump", &state, 0, 0, 10, 12, 7, FILTER_OK);
+	check("jump", &state, 700, 10, 20, 12, 7, FILTER_OK);
+	for (i = 1; i <= FILTER_MAX_REJECTS; i++) {
+		check("jump", &state, 100000, 10 + i, 20 + i, 12, 7, FILTER_JUMP);
+	}
+	check("jump", &state, 100000, 14, 24, 12, 7, FILTER_OK);
+	check("jump", &state, 100500, 24, 34, 12, 7, FILTER_OK);
+
+	// satellites and hdop, a cold start forgets the last fix
+	memset(&state, 0, sizeof(state));
+	check("quality", &state, 0, 0, 10, 12, 7, FILTER_OK);
+	check("quality", &state, 100, 10, 20, 12, FILTER_MIN_SATS - 1,
+		FILTER_SATS);
+	check("quality", &state, 100, 10, 20, FILTER_MAX_HDOP + 1, 7,
+		FILTER_HDOP);
+	check("quality", &state, 100, 10, 20, FILTER_MAX_HDOP, FILTER_MIN_SATS,
+		FILTER_OK);
+	filter_reset(&state);
+	check("quality", &state, 0, 0, 5, 12, 7, FILTER_OK);
+
+	printf("filtertest: %d fixes ok, %d failed\n", checked - failures, failures);
+	return failures ? 1 : 0;
+}
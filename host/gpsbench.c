@@ -0,0 +1,136 @@
+/* ----------------------------------------------------
+ * File    : gpsbench.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host benchmark of the $GPSACP parser in gps.c. The responses of a
+ * corpus file, one per line, are parsed the way parse_gps() in
+ * beacon.c does it, over and over, and the throughput is reported.
+ *
+ * Usage:
+ *   gpsbench [-n passes] [corpus]
+ *
+ * The corpus defaults to gpsacp.txt, the passes to 100000.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "gps.h"
+
+#define MAX_LINES	1000
+#define LINE_SIZE	160
+
+static char lines[MAX_LINES][LINE_SIZE];
+static int line_count = 0;
+static long corpus_bytes = 0;
+
+
+
+/*
+ * Reads the corpus, each response ends with CR as from the module.
+ */
+static int load(const char *name) {
+	FILE *f = fopen(name, "r");
+	char buf[LINE_SIZE];
+	if (f == NULL) {
+		perror(name);
+		return 0;
+	}
+	while ((line_count < MAX_LINES) && fgets(buf, sizeof(buf) - 1, f)) {
+		buf[strcspn(buf, "\r\n")] = '\0';
+		if (buf[0] == '\0') {
+			continue;
+		}
+		strcat(buf, "\r");
+		strcpy(lines[line_count++], buf);
+		corpus_bytes += strlen(buf);
+	}
+	fclose(f);
+	return line_count;
+}
+
+
+
+/*
+ * Parses a response like parse_gps(), returns TRUE for a usable fix.
+ */
+static int parse(char *msg, gps_position *pos) {
+	gps_fields fields;
+	if (!gps_split(msg, &fields)) {
+		return 0;
+	}
+	if ((fields.fix[0] < '2') || (fields.fix[0] > '3') ||
+			(gps_hdop(fields.hdop) == 255) ||
+			!gps_position_of(&fields, pos)) {
+		return 0;
+	}
+	pos->utc = 0;
+	if ((strlen(fields.time) == 6) && (strlen(fields.date) == 6)) {
+		pos->utc = gps_2digits(fields.time) * 3600L +
+			gps_2digits(fields.time + 2) * 60 + gps_2digits(fields.time + 4) +
+			gps_2digits(fields.date) * 86400L;
+	}
+	return 1;
+}
+
+
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	const char *name = "gpsacp.txt";
+	long passes = 100000;
+	long pass;
+	long fixes = 0;
+	uint32_t sum = 0;
+	double start, seconds, parsed;
+	gps_position pos;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+			passes = atol(argv[++i]);
+		}
+		else if (argv[i][0] == '-') {
+			fprintf(stderr, "usage: gpsbench [-n passes] [corpus]\n");
+			return 2;
+		}
+		else {
+			name = argv[i];
+		}
+	}
+	if ((passes < 1) || !load(name)) {
+		return 2;
+	}
+
+	start = now();
+	for (pass = 0; pass < passes; pass++) {
+		for (i = 0; i < line_count; i++) {
+			if (parse(lines[i], &pos)) {
+				fixes++;
+				sum += pos.lat_min ^ pos.lon_min ^ pos.utc;
+			}
+		}
+	}
+	seconds = now() - start;
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+
+	parsed = (double)passes * line_count;
+	printf("gpsbench: %d responses, %ld bytes, %ld passes, %ld fixes (%08x)\n",
+		line_count, corpus_bytes, passes, fixes / passes, (unsigned)sum);
+	printf("%.3f s, %.0f responses/s, %.2f MB/s, %.0f ns/response\n",
+		seconds, parsed / seconds, passes * corpus_bytes / seconds / 1e6,
+		seconds * 1e9 / parsed);
+	return 0;
+}
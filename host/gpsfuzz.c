@@ -0,0 +1,217 @@
+/* ----------------------------------------------------
+ * File    : gpsfuzz.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc or clang, POSIX
+ *
+ * Fuzz target for the $GPSACP parser in gps.c. Each input is parsed
+ * the way parse_gps() in beacon.c does it, in a buffer of its own
+ * size, so a sanitizer catches any read or write out of it. The
+ * results are checked against their ranges, abort() on a violation.
+ *
+ * libFuzzer:
+ *   clang -g -O1 -fsanitize=fuzzer,address,undefined -I.. \
+ *     -o gpsfuzz gpsfuzz.c ../gps.c
+ *   ./gpsfuzz gpscorpus/
+ *
+ * AFL, and without a fuzzer, build with -DGPSFUZZ_MAIN:
+ *   afl-clang-fast -DGPSFUZZ_MAIN -I.. -o gpsfuzz gpsfuzz.c ../gps.c
+ *   afl-fuzz -i gpscorpus -o findings ./gpsfuzz
+ *
+ *   gpsfuzz			reads one input from stdin
+ *   gpsfuzz file...	each file is one input
+ *   gpsfuzz -r n corpus	each line of the corpus, and n random
+ *						mutations of each
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "gps.h"
+
+// longer lines do not fit into the receive buffer of the uart
+#define MAX_INPUT	128
+
+#define CHECK(cond) \
+	if (!(cond)) { \
+		fprintf(stderr, "gpsfuzz: %s failed\n", #cond); \
+		abort(); \
+	}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+
+
+/*
+ * A field must be terminated within its buffer.
+ */
+static void check_field(const char *field, size_t size) {
+	CHECK(memchr(field, '\0', size) != NULL);
+}
+
+
+
+static void check_degrees(const char *str) {
+	uint8_t degree;
+	uint32_t millionths;
+	if (gps_degrees(str, &degree, &millionths)) {
+		CHECK(degree <= 180);
+		CHECK(millionths < 1000000L);
+	}
+}
+
+
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	gps_fields fields;
+	gps_position pos;
+	char *msg;
+	char *end;
+	char token[4];
+
+	if (size > MAX_INPUT) {
+		return 0;
+	}
+	// the uart hands over a string, with the CR but without NULs
+	msg = malloc(size + 1);
+	memcpy(msg, data, size);
+	msg[size] = '\0';
+
+	end = gps_skip(msg, ',');
+	CHECK((end >= msg) && (end <= msg + size));
+	end = gps_token(msg, token, sizeof(token), ':');
+	CHECK((end >= msg) && (end <= msg + size));
+	check_field(token, sizeof(token));
+
+	memset(&fields, 0xaa, sizeof(fields));
+	if (gps_split(msg, &fields)) {
+		check_field(fields.time, sizeof(fields.time));
+		check_field(fields.ms, sizeof(fields.ms));
+		check_field(fields.lat, sizeof(fields.lat));
+		check_field(fields.lon, sizeof(fields.lon));
+		check_field(fields.hdop, sizeof(fields.hdop));
+		check_field(fields.alt, sizeof(fields.alt));
+		check_field(fields.fix, sizeof(fields.fix));
+		check_field(fields.date, sizeof(fields.date));
+		check_field(fields.sats, sizeof(fields.sats));
+
+		check_degrees(fields.lat);
+		check_degrees(fields.lon);
+		CHECK(gps_hdop(fields.hdop) <= 255);
+		if (gps_position_of(&fields, &pos)) {
+			CHECK(pos.fix == (uint8_t)fields.fix[0]);
+		}
+	}
+	free(msg);
+	return 0;
+}
+
+
+
+#ifdef GPSFUZZ_MAIN
+
+static uint8_t input[MAX_INPUT + 1];
+
+
+
+static size_t read_input(FILE *f) {
+	return fread(input, 1, sizeof(input), f);
+}
+
+
+
+/*
+ * Flips, replaces, inserts and drops random chars of a corpus line.
+ */
+static size_t mutate(const char *line, uint8_t *buf) {
+	size_t n = strlen(line);
+	int edits = 1 + rand() % 8;
+	size_t pos;
+	memcpy(buf, line, n);
+	while (edits--) {
+		pos = n ? rand() % n : 0;
+		switch (rand() % 4) {
+			case 0:
+				if (n) {
+					buf[pos] ^= 1 << (rand() % 8);
+				}
+				break;
+			case 1:
+				if (n) {
+					buf[pos] = ",.:0123456789NSEW \r"[rand() % 19];
+				}
+				break;
+			case 2:
+				if (n < MAX_INPUT) {
+					memmove(buf + pos + 1, buf + pos, n - pos);
+					buf[pos] = rand() % 2 ? ',' : '0' + rand() % 10;
+					n++;
+				}
+				break;
+			default:
+				if (n) {
+					memmove(buf + pos, buf + pos + 1, n - pos - 1);
+					n--;
+				}
+				break;
+		}
+	}
+	return n;
+}
+
+
+
+static int run_corpus(const char *name, long runs) {
+	FILE *f = fopen(name, "r");
+	char line[MAX_INPUT + 1];
+	long lines = 0;
+	long i;
+	size_t n;
+
+	if (f == NULL) {
+		perror(name);
+		return 2;
+	}
+	srand(1);
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		strcat(line, "\r");
+		LLVMFuzzerTestOneInput((uint8_t *)line, strlen(line));
+		for (i = 0; i < runs; i++) {
+			n = mutate(line, input);
+			LLVMFuzzerTestOneInput(input, n);
+		}
+		lines++;
+	}
+	fclose(f);
+	printf("gpsfuzz: %ld lines, %ld inputs ok\n", lines, lines * (runs + 1));
+	return 0;
+}
+
+
+
+int main(int argc, char *argv[]) {
+	FILE *f;
+	size_t n;
+	int i;
+
+	if ((argc == 4) && (strcmp(argv[1], "-r") == 0)) {
+		return run_corpus(argv[3], atol(argv[2]));
+	}
+	if (argc == 1) {
+		n = read_input(stdin);
+		return LLVMFuzzerTestOneInput(input, n);
+	}
+	for (i = 1; i < argc; i++) {
+		if ((f = fopen(argv[i], "rb")) == NULL) {
+			perror(argv[i]);
+			return 2;
+		}
+		n = read_input(f);
+		fclose(f);
+		LLVMFuzzerTestOneInput(input, n);
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,402 @@
+/* ----------------------------------------------------
+ * File    : pdutest.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host test of the SMS PDU encoding in sms.c. Messages are encoded
+ * part by part the way send_sms_pdu() in beacon.c does it, then each
+ * PDU is decoded again after GSM 03.40 and GSM 03.38 and compared
+ * with what was sent.
+ *
+ * Usage:
+ *   pdutest [-v]
+ *
+ * -v prints the PDUs in hex, as they go to AT+CMGS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "sms.h"
+
+#define PDU_SIZE	200
+#define TEXT_SIZE	600
+
+static uint8_t pdu[PDU_SIZE];
+static int pdu_length = 0;
+static int verbose = 0;
+static int failures = 0;
+static int checked = 0;
+
+
+
+static void sink(uint8_t octet) {
+	if (pdu_length < PDU_SIZE) {
+		pdu[pdu_length] = octet;
+	}
+	pdu_length++;
+}
+
+static void fail(const char *name, const char *what) {
+	printf("FAIL %s: %s\n", name, what);
+	failures++;
+}
+
+
+
+/*
+ * The GSM 7 bit default alphabet, the chars that have an ASCII form.
+ */
+static char gsm_default(uint8_t septet) {
+	switch (septet) {
+		case 0x00: return '@';
+		case 0x02: return '$';
+		case 0x0a: return '\n';
+		case 0x0d: return '\r';
+		case 0x11: return '_';
+		case 0x24: return 0;		// currency sign
+		case 0x40: return 0;		// inverted exclamation mark
+		default:
+			if ((septet >= 0x5b) && (septet <= 0x60)) {
+				return 0;			// national letters
+			}
+			if ((septet >= ' ') && (septet <= 'z')) {
+				return septet;
+			}
+			return 0;
+	}
+}
+
+
+
+/*
+ * The GSM extension table, reached with an escape.
+ */
+static char gsm_extension(uint8_t septet) {
+	switch (septet) {
+		case 0x14: return '^';
+		case 0x28: return '{';
+		case 0x29: return '}';
+		case 0x2f: return '\\';
+		case 0x3c: return '[';
+		case 0x3d: return '~';
+		case 0x3e: return ']';
+		case 0x40: return '|';
+		default: return 0;
+	}
+}
+
+
+
+/*
+ * The text as it should arrive: chars without a GSM form become '?'.
+ */
+static void expected_text(const char *text, char *out) {
+	const char *extension = "^{}\\[~]|";
+	for (; *text; text++) {
+		if (strchr(extension, *text) || (*text == '@') || (*text == '$') ||
+				(*text == '_') || (*text == '\n') || (*text == '\r') ||
+				((*text >= ' ') && (*text <= 'z') && (*text != '`'))) {
+			*out++ = *text;
+		}
+		else {
+			*out++ = '?';
+		}
+	}
+	*out = 0;
+}
+
+
+
+/*
+ * Decodes a semi octet number, length in digits.
+ */
+static int decode_number(const uint8_t *p, int digits, int toa, char *out) {
+	int i;
+	if (toa == 0x91) {
+		*out++ = '+';
+	}
+	else if (toa != 0x81) {
+		return 0;
+	}
+	for (i = 0; i < digits; i++) {
+		uint8_t d = (i & 1) ? p[i / 2] >> 4 : p[i / 2] & 0x0f;
+		if ((d == 0x0f) && (i == digits - 1) && (i & 1)) {
+			break;		// fill nibble, the length was in octets
+		}
+		if (d > 9) {
+			return 0;
+		}
+		*out++ = '0' + d;
+	}
+	if ((digits & 1) && ((p[digits / 2] >> 4) != 0x0f)) {
+		return 0;		// no fill nibble
+	}
+	*out = 0;
+	return 1;
+}
+
+
+
+/*
+ * Decodes an SMS-SUBMIT PDU and checks its header.
+ * tpdu		the length given to AT+CMGS
+ * text		gets the 7 bit text, data the 8 bit data
+ * udh		gets ref, total and seq of a concatenated message
+ * return	int	length of the 8 bit data or of the text, -1 on errors
+ */
+static int decode(const char *name, const char *smsc, const char *number,
+		int tpdu, char *text, uint8_t *data, int *udh) {
+	char digits[20];
+	const uint8_t *p = pdu;
+	const uint8_t *ud;
+	int udhi;
+	int dcs;
+	int udl;
+	int skip = 0;
+	int n;
+	int i;
+	// SMSC
+	if (*smsc) {
+		if ((p[0] != 1 + ((int)strlen(smsc) - (*smsc == '+') + 1) / 2) ||
+				!decode_number(p + 2, (p[0] - 1) * 2, p[1], digits) ||
+				strcmp(digits, smsc)) {
+			fail(name, "smsc");
+			return -1;
+		}
+	}
+	else if (p[0] != 0) {
+		fail(name, "smsc not empty");
+		return -1;
+	}
+	p += 1 + p[0];
+	if (pdu_length - (p - pdu) != tpdu) {
+		fail(name, "tpdu length does not match AT+CMGS");
+		return -1;
+	}
+	// first octet: SMS-SUBMIT, no validity period, maybe UDHI
+	if ((p[0] & ~0x40) != 0x01) {
+		fail(name, "first octet");
+		return -1;
+	}
+	udhi = p[0] & 0x40;
+	if (p[1] != 0) {
+		fail(name, "message reference");
+		return -1;
+	}
+	// destination, length in digits
+	if (!decode_number(p + 4, p[2], p[3], digits) || strcmp(digits, number)) {
+		fail(name, "destination");
+		return -1;
+	}
+	p += 4 + (p[2] + 1) / 2;
+	if (p[0] != 0) {
+		fail(name, "protocol identifier");
+		return -1;
+	}
+	dcs = p[1];
+	udl = p[2];
+	ud = p + 3;
+	n = pdu_length - (ud - pdu);
+	if ((dcs == SMS_DCS_7BIT) ? ((udl > SMS_MAX_SEPTETS) || (n != (udl * 7 + 7) / 8)) :
+			((dcs != SMS_DCS_8BIT) || (udl > SMS_MAX_OCTETS) || (n != udl))) {
+		fail(name, "user data length");
+		return -1;
+	}
+	udh[0] = udh[1] = udh[2] = 0;
+	if (udhi) {
+		// one element, concatenated message with 8 bit reference
+		if ((ud[0] != 5) || (ud[1] != 0) || (ud[2] != 3)) {
+			fail(name, "user data header");
+			return -1;
+		}
+		udh[0] = ud[3];
+		udh[1] = ud[4];
+		udh[2] = ud[5];
+		skip = 6;
+	}
+	if (dcs == SMS_DCS_8BIT) {
+		memcpy(data, ud + skip, udl - skip);
+		return udl - skip;
+	}
+	// 7 bit, the header is followed by fill bits up to a septet
+	n = 0;
+	for (i = (skip * 8 + 6) / 7; i < udl; i++) {
+		int bit = i * 7;
+		uint8_t septet = ((ud[bit / 8] | (ud[bit / 8 + 1] << 8)) >> (bit % 8)) & 0x7f;
+		if (septet == 0x1b) {
+			i++;
+			bit = i * 7;
+			if (i >= udl) {
+				fail(name, "escape at the end");
+				return -1;
+			}
+			septet = ((ud[bit / 8] | (ud[bit / 8 + 1] << 8)) >> (bit % 8)) & 0x7f;
+			text[n] = gsm_extension(septet);
+		}
+		else {
+			text[n] = gsm_default(septet);
+		}
+		if (text[n] == 0) {
+			fail(name, "septet without an ASCII form");
+			return -1;
+		}
+		n++;
+	}
+	text[n] = 0;
+	return n;
+}
+
+
+
+static void print_pdu(void) {
+	int i;
+	if (verbose) {
+		for (i = 0; i < pdu_length; i++) {
+			printf("%02X", pdu[i]);
+		}
+		printf("\n");
+	}
+}
+
+
+
+/*
+ * Sends a text as send_sms_pdu() does and checks what arrives.
+ */
+static void check_text(const char *name, const char *smsc, const char *number,
+		const char *text, int want_parts) {
+	static uint8_t ref = 0;
+	char expected[TEXT_SIZE];
+	char received[TEXT_SIZE];
+	char part_text[TEXT_SIZE];
+	uint8_t data[PDU_SIZE];
+	const char *p = text;
+	int udh[3];
+	uint8_t parts = 1;
+	uint8_t part;
+	uint8_t udl;
+	uint8_t n;
+	received[0] = 0;
+	if (sms_septets(text, 255) > SMS_MAX_SEPTETS) {
+		parts = sms_parts(text);
+		ref++;
+	}
+	if ((want_parts != 0) && (parts != want_parts)) {
+		fail(name, "number of parts");
+		return;
+	}
+	for (part = 1; part <= parts; part++) {
+		n = sms_fit(p, (parts > 1) ? SMS_PART_SEPTETS : SMS_MAX_SEPTETS);
+		udl = sms_septets(p, n);
+		if (parts > 1) {
+			udl += SMS_UDH_SEPTETS;
+		}
+		pdu_length = 0;
+		sms_header(sink, smsc, number, SMS_DCS_7BIT, udl, parts > 1);
+		if (parts > 1) {
+			sms_udh(sink, ref, parts, part);
+		}
+		sms_pack7(sink, p, n, (parts > 1) ? 1 : 0);
+		print_pdu();
+		if (decode(name, smsc, number, sms_tpdu_length(number, (udl * 7 + 7) / 8),
+				part_text, data, udh) < 0) {
+			return;
+		}
+		if ((parts > 1) && ((udh[0] != ref) || (udh[1] != parts) || (udh[2] != part))) {
+			fail(name, "concatenation header");
+			return;
+		}
+		strcat(received, part_text);
+		p += n;
+	}
+	if (*p) {
+		fail(name, "text left over after the last part");
+		return;
+	}
+	expected_text(text, expected);
+	if (strcmp(expected, received)) {
+		fail(name, "text differs");
+		printf("  sent     %s\n  received %s\n", expected, received);
+		return;
+	}
+	checked++;
+}
+
+
+
+/*
+ * Sends 8 bit data and checks what arrives.
+ */
+static void check_data(const char *name, const char *smsc, const char *number,
+		const uint8_t *data, uint8_t length) {
+	char text[TEXT_SIZE];
+	uint8_t received[PDU_SIZE];
+	int udh[3];
+	int n;
+	pdu_length = 0;
+	sms_header(sink, smsc, number, SMS_DCS_8BIT, length, 0);
+	for (n = 0; n < length; n++) {
+		sink(data[n]);
+	}
+	print_pdu();
+	n = decode(name, smsc, number, sms_tpdu_length(number, length),
+		text, received, udh);
+	if (n < 0) {
+		return;
+	}
+	if ((n != length) || memcmp(data, received, length)) {
+		fail(name, "data differs");
+		return;
+	}
+	checked++;
+}
+
+
+
+int main(int argc, char **argv) {
+	char text[TEXT_SIZE];
+	uint8_t data[SMS_MAX_OCTETS];
+	int i;
+	verbose = (argc > 1) && !strcmp(argv[1], "-v");
+
+	check_text("report", "", "7676245",
+		"alex@tinkerlog.com http://maps.google.com/maps?q=54.565786,9.914613"
+		"%28Alex%20" "2007-07-13T12:06:31Z%29&t=k&z=16", 1);
+	check_text("smsc", "+491710760000", "+4917012345678", "hello", 1);
+	check_text("odd smsc", "+49171076000", "017012345678", "hello", 1);
+	check_text("escapes", "", "7676245", "a{b}c[d]e~f|g\\h^i", 1);
+	check_text("unknown chars", "", "7676245", "tab\there `quoted` \x7f\x80", 1);
+	check_text("at signs", "", "7676245", "@@@@@@@", 1);
+	check_text("one octet left", "", "7676245", "1234567", 1);
+	check_text("eight septets", "", "7676245", "12345678", 1);
+	check_text("empty", "", "7676245", "", 1);
+	memset(text, 'x', 160);
+	text[160] = 0;
+	check_text("160 chars", "", "7676245", text, 1);
+	text[159] = '{';
+	check_text("escape at 160", "", "7676245", text, 2);
+	memset(text, 'x', 200);
+	text[200] = 0;
+	check_text("200 chars", "", "7676245", text, 2);
+	memset(text, '{', 200);
+	check_text("200 escapes", "", "7676245", text, 3);
+	if (sms_septets(text, 255) != 400) {
+		fail("200 escapes", "septets");
+	}
+	// the escape never fits at the end of a part, each part leaves one
+	// septet unused: 152 + 154 septets need 3 parts, not 2
+	memset(text, 'a', 152);
+	memset(text + 152, '{', 77);
+	text[229] = 0;
+	check_text("escapes at the part ends", "", "7676245", text, 3);
+	for (i = 0; i < SMS_MAX_OCTETS; i++) {
+		data[i] = i * 7;
+	}
+	check_data("8 bit", "", "7676245", data, SMS_MAX_OCTETS);
+	check_data("8 bit, smsc", "+491710760000", "+4917012345678", data, 12);
+
+	printf("pdutest: %d messages ok, %d failed\n", checked, failures);
+	return failures ? 1 : 0;
+}
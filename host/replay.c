@@ -0,0 +1,389 @@
+/* ----------------------------------------------------
+ * File    : replay.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Deterministic replay of a modem capture on the host. The received
+ * bytes go through the RX interrupt handler and uart_gets() of
+ * uart.c, built with the shims in shim/. Each line is handled the
+ * way beacon.c does it: $GPSACP responses are parsed with gps.c and
+ * go through the poll policy of acquire.c, a fix it would take is
+ * checked with filter.c, errors are classified with aterr.c. A
+ * restart of the GPS, AT$GPSR, resets the policy and the filter. The
+ * time is the time of the capture, so the same capture always gives
+ * the same output.
+ *
+ * Usage:
+ *   replay [-m min_fix] [-b budget] [-h max_hdop] [-e expected] capture
+ *
+ * The capture is the output of "beaconctl capture", "ms R|T hex"
+ * per byte. min_fix, budget and max_hdop are the config fields,
+ * the defaults are those of config.c. With -e the output is compared
+ * with the expected file instead of printed, the exit code is 1 if
+ * they differ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "uart.h"
+#include "gps.h"
+#include "filter.h"
+#include "acquire.h"
+#include "aterr.h"
+#include "rtc.h"
+#include "timer.h"
+#include "eeq.h"
+#include "idle.h"
+
+#define LINE_SIZE	160
+
+// the registers of the shim
+volatile uint8_t UDR;
+volatile uint8_t UCSRA = (1 << UDRE);
+volatile uint8_t UCSRB;
+volatile uint8_t UCSRC;
+volatile uint8_t UBRRH;
+volatile uint8_t UBRRL;
+volatile uint8_t SREG;
+
+volatile uint8_t idle_source;
+
+static uint32_t replay_ms = 0;
+static FILE *out;
+
+// config
+static uint8_t min_fix = 2;
+static uint16_t fix_budget = 60;
+static uint8_t max_hdop = 0;
+
+// state of request_gps()
+static filter_state gps_filter;
+static gps_position position;
+static uint8_t gps_sats;
+static uint8_t gps_hdop_tenths;
+
+static const char *filter_names[FILTER_RESULTS] = {
+	"ok", "stale", "sats", "hdop", "jump"
+};
+
+
+
+/*
+ * The firmware functions the modules need, on the clock of the
+ * capture.
+ */
+uint32_t timer_millis(void) {
+	return replay_ms;
+}
+
+uint32_t timer_uptime(void) {
+	return replay_ms / 1000;
+}
+
+void eeq_write_block(const void *src, void *dst, uint8_t n) {
+	memcpy(dst, src, n);
+}
+
+void eeq_flush(void) {
+}
+
+
+
+static int32_t to_udeg(uint8_t deg, uint32_t millionths) {
+	return deg * 1000000L + millionths;
+}
+
+
+
+/*
+ * parse_gps() of beacon.c.
+ */
+static void parse_gps(char *msg) {
+	gps_fields fields;
+	gps_position pos;
+	rtc_time utc;
+	uint8_t fix;
+
+	if (!gps_split(msg, &fields)) {
+		return;
+	}
+	gps_hdop_tenths = gps_hdop(fields.hdop);
+	fix = fields.fix[0];
+	gps_sats = atoi(fields.sats);
+	if ((fix >= '2') && (fix <= '3') &&
+			((max_hdop == 0) || (gps_hdop_tenths <= max_hdop)) &&
+			gps_position_of(&fields, &pos)) {
+		pos.utc = 0;
+		if ((strlen(fields.time) == 6) && (strlen(fields.date) == 6)) {
+			utc.hour = gps_2digits(fields.time);
+			utc.minute = gps_2digits(fields.time + 2);
+			utc.second = gps_2digits(fields.time + 4);
+			utc.day = gps_2digits(fields.date);
+			utc.month = gps_2digits(fields.date + 2);
+			utc.year = gps_2digits(fields.date + 4);
+			if ((utc.month >= 1) && (utc.month <= 12) && (utc.day >= 1) &&
+					(utc.day <= 31) && (utc.hour < 24) && (utc.minute < 60) &&
+					(utc.second < 60) && (utc.year < 100)) {
+				pos.utc = rtc_make(&utc);
+			}
+		}
+		position = pos;
+	}
+}
+
+
+
+/*
+ * check_fix() of beacon.c.
+ */
+static uint8_t check_fix(void) {
+	filter_fix fix;
+	uint8_t result;
+	fix.lat = to_udeg(position.lat_deg, position.lat_min);
+	fix.lon = to_udeg(position.lon_deg, position.lon_min);
+	fix.utc = position.utc;
+	fix.time = timer_uptime();
+	fix.hdop = gps_hdop_tenths;
+	fix.sats = gps_sats;
+	result = filter_check(&gps_filter, &fix);
+	if (result == FILTER_OK) {
+		position.lat_deg = fix.lat / 1000000L;
+		position.lat_min = fix.lat % 1000000L;
+		position.lon_deg = fix.lon / 1000000L;
+		position.lon_min = fix.lon % 1000000L;
+	}
+	return result;
+}
+
+
+
+/*
+ * request_gps() of beacon.c, for a $GPSACP response.
+ */
+static void request_gps(char *line) {
+	rtc_time utc;
+	uint8_t fix;
+	uint8_t result;
+	uint16_t wait;
+
+	position.fix = 0;
+	gps_sats = 0;
+	gps_hdop_tenths = 0;
+	if (strlen(line) > 29) {
+		parse_gps(line);
+	}
+	fprintf(out, "%u gps fix %c sats %u hdop %u", replay_ms,
+		position.fix ? position.fix : '0', gps_sats, gps_hdop_tenths);
+	if (position.fix > 0) {
+		rtc_split(position.utc, &utc);
+		fprintf(out, " %u.%06u %u.%06u %02u%02u%02u %02u%02u%02u",
+			position.lat_deg, position.lat_min,
+			position.lon_deg, position.lon_min,
+			utc.year, utc.month, utc.day, utc.hour, utc.minute, utc.second);
+	}
+	fix = position.fix ? position.fix - '0' : 0;
+	if (acquire_ready(fix, min_fix, fix_budget, replay_ms)) {
+		result = check_fix();
+		fprintf(out, " filter %s", filter_names[result]);
+		if (result != FILTER_OK) {
+			position.fix = 0;
+			fix = 0;
+		}
+	}
+	wait = acquire_poll(fix, gps_sats, min_fix, fix_budget, replay_ms);
+	if (wait == 0) {
+		fprintf(out, " -> take\n");
+	}
+	else if (position.fix > 0) {
+		fprintf(out, " -> hold %u\n", wait);
+	}
+	else {
+		fprintf(out, " -> wait %u\n", wait);
+	}
+}
+
+
+
+/*
+ * Handles a line of the modem.
+ */
+static void handle_line(char *line) {
+	char text[LINE_SIZE];
+	uint8_t class;
+	strcpy(text, line);
+	text[strcspn(text, "\r\n")] = '\0';
+	if (text[0] == '\0') {
+		return;
+	}
+	if (strcmp(line, "> ") == 0) {
+		fprintf(out, "%u prompt\n", replay_ms);
+	}
+	else if (strncmp(text, "$GPSACP", 7) == 0) {
+		request_gps(line);
+	}
+	else if (strcmp(text, "OK") == 0) {
+		fprintf(out, "%u ok\n", replay_ms);
+	}
+	else if ((strcmp(text, "ERROR") == 0) ||
+			(strncmp(text, "+CME ERROR", 10) == 0) ||
+			(strncmp(text, "+CMS ERROR", 10) == 0)) {
+		class = aterr_classify(text);
+		fprintf(out, "%u error %u%s %s\n", replay_ms, class,
+			aterr_retry(class) ? " retry" : "", text);
+	}
+	else {
+		fprintf(out, "%u line %s\n", replay_ms, text);
+	}
+}
+
+
+
+/*
+ * Collects the bytes sent to the modem into commands.
+ */
+static void sent(uint8_t c) {
+	static char command[LINE_SIZE];
+	static uint8_t length = 0;
+	if ((c == '\r') || (c == 0x1a) || (c == 0x1b)) {
+		command[length] = '\0';
+		if (strncmp(command, "AT$GPSR", 7) == 0) {
+			// cold_gps() of beacon.c
+			acquire_reset();
+			filter_reset(&gps_filter);
+		}
+		fprintf(out, "%u send %s%s\n", replay_ms, command,
+			(c == 0x1a) ? "<^Z>" : (c == 0x1b) ? "<ESC>" : "");
+		length = 0;
+	}
+	else if ((c != '\n') && (length < LINE_SIZE - 1)) {
+		command[length++] = c;
+	}
+}
+
+
+
+/*
+ * Plays the capture, returns FALSE if it could not be read.
+ */
+static int replay(const char *name) {
+	FILE *in = fopen(name, "r");
+	char line[LINE_SIZE];
+	char buf[LINE_SIZE];
+	unsigned ms;
+	char dir;
+	unsigned value;
+	uint16_t dropped = 0;
+	if (in == NULL) {
+		perror(name);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		if ((sscanf(line, "%u %c %x", &ms, &dir, &value) != 3) ||
+				((dir != 'R') && (dir != 'T'))) {
+			continue;
+		}
+		replay_ms = ms;
+		if (dir == 'T') {
+			sent(value);
+			continue;
+		}
+		UDR = value;
+		USART_RXC_vect();
+		while (uart_gets(buf, sizeof(buf)) != 0) {
+			handle_line(buf);
+		}
+		if (uart_dropped != dropped) {
+			dropped = uart_dropped;
+			fprintf(out, "%u dropped %u\n", replay_ms, dropped);
+		}
+	}
+	fclose(in);
+	return 1;
+}
+
+
+
+/*
+ * Compares the output with the expected file, returns the number of
+ * the first line that differs, 0 if none.
+ */
+static int compare(FILE *expected, int *lines) {
+	char want[LINE_SIZE];
+	char got[LINE_SIZE];
+	char *w;
+	char *g;
+	*lines = 0;
+	rewind(out);
+	while (1) {
+		w = fgets(want, sizeof(want), expected);
+		g = fgets(got, sizeof(got), out);
+		if ((w == NULL) && (g == NULL)) {
+			return 0;
+		}
+		(*lines)++;
+		if ((w == NULL) || (g == NULL) || strcmp(want, got)) {
+			printf("replay: line %d differs\n  expected: %s  got:      %s",
+				*lines, w ? want : "(end)\n", g ? got : "(end)\n");
+			return *lines;
+		}
+	}
+}
+
+
+
+static void usage(void) {
+	fprintf(stderr, "usage: replay [-m min_fix] [-b budget] [-h max_hdop] "
+		"[-e expected] capture\n");
+}
+
+int main(int argc, char *argv[]) {
+	const char *expected_name = NULL;
+	FILE *expected;
+	int lines;
+	int result;
+	int i;
+
+	for (i = 1; (i < argc - 1) && (argv[i][0] == '-'); i += 2) {
+		if (strcmp(argv[i], "-m") == 0) {
+			min_fix = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-b") == 0) {
+			fix_budget = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-h") == 0) {
+			max_hdop = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-e") == 0) {
+			expected_name = argv[i + 1];
+		}
+		else {
+			break;
+		}
+	}
+	if (i != argc - 1) {
+		usage();
+		return 2;
+	}
+
+	out = expected_name ? tmpfile() : stdout;
+	if ((out == NULL) || !replay(argv[i])) {
+		return 2;
+	}
+	if (expected_name == NULL) {
+		return 0;
+	}
+	if ((expected = fopen(expected_name, "r")) == NULL) {
+		perror(expected_name);
+		return 2;
+	}
+	result = compare(expected, &lines);
+	fclose(expected);
+	if (result == 0) {
+		printf("replay: %s, %d lines as expected\n", argv[i], lines);
+	}
+	return result ? 1 : 0;
+}
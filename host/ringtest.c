@@ -0,0 +1,276 @@
+/* ----------------------------------------------------
+ * File    : ringtest.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Stress test of ring.h. A timer signal stands in for the receive
+ * interrupt: it stages a frame of consecutive byte values a few
+ * chars per signal, like uart.c stages a line, then publishes it
+ * with commit() or drops it with discard(), or puts single chars.
+ * The main loop reads with get(), read(), peek(), find() and skip()
+ * while the signals come in and checks that it sees the published
+ * frames in order, never a staged or dropped char. A small ring is
+ * used, so it runs full often.
+ *
+ * Usage:
+ *   ringtest [-n frames]
+ *
+ * Runs until the producer has published the frames, 20000 by
+ * default, or for 20 seconds at most.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include "ring.h"
+
+#define RING_SIZE	16
+#define MAX_FRAME	12		// chars, fits into the empty ring
+#define MAX_SECONDS	20
+
+RING_DEFINE(ring, RING_SIZE)
+
+// producer, only touched by the signal handler while the timer runs
+static uint32_t producer_seed = 1;
+static uint8_t produced = 0;		// next value to stage
+static uint8_t frame_start = 0;
+static uint8_t frame_left = 0;
+static volatile unsigned long committed = 0;
+static volatile unsigned long discarded = 0;
+static volatile unsigned long full = 0;
+static volatile unsigned long published = 0;
+static volatile int producer_error = 0;
+
+// consumer
+static uint32_t consumer_seed = 2;
+static uint8_t expected = 0;
+static unsigned long consumed = 0;
+static int failures = 0;
+
+
+
+static uint8_t random8(uint32_t *seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+
+
+/*
+ * Stages the next char of the frame, publishes or drops the frame
+ * at its end. A frame that does not fit is dropped, like a line
+ * that overflows the receive buffer.
+ */
+static void produce(void) {
+	uint8_t length;
+	if (frame_left == 0) {
+		if (random8(&producer_seed) % 4 == 0) {
+			if (ring_put(produced)) {
+				produced++;
+				committed++;
+				published++;
+			}
+			else {
+				full++;
+			}
+			return;
+		}
+		frame_left = 1 + random8(&producer_seed) % MAX_FRAME;
+		frame_start = produced;
+	}
+	if (!ring_push(produced)) {
+		ring_discard();
+		produced = frame_start;
+		frame_left = 0;
+		full++;
+		return;
+	}
+	if (ring_staged(0) != produced) {
+		producer_error = __LINE__;
+	}
+	produced++;
+	frame_left--;
+	length = produced - frame_start;
+	if ((ring_pending() != length) ||
+			((length > 1) && (ring_staged(1) != (uint8_t)(produced - 2)))) {
+		producer_error = __LINE__;
+	}
+	if (frame_left > 0) {
+		return;
+	}
+	if (random8(&producer_seed) % 8 == 0) {
+		ring_discard();
+		produced = frame_start;
+		discarded++;
+		if (ring_pending() != 0) {
+			producer_error = __LINE__;
+		}
+	}
+	else {
+		ring_commit();
+		committed++;
+		published += length;
+		if (ring_pending() != 0) {
+			producer_error = __LINE__;
+		}
+	}
+}
+
+
+
+/*
+ * The simulated interrupt, one to three chars.
+ */
+static void interrupt(int sig) {
+	uint8_t n = 1 + random8(&producer_seed) % 3;
+	while (n--) {
+		produce();
+	}
+}
+
+
+
+static void fail(const char *what, unsigned got) {
+	if (failures++ < 10) {
+		printf("FAIL %s: got %u, expected %u after %lu chars\n",
+			what, got, expected, consumed);
+	}
+}
+
+
+
+static void check(const char *what, uint8_t c) {
+	if (c != expected) {
+		fail(what, c);
+		expected = c;
+	}
+	expected++;
+	consumed++;
+}
+
+
+
+/*
+ * Reads some chars in one of the ways uart.c does, now and then
+ * from a full ring.
+ */
+static void consume(void) {
+	uint8_t buf[RING_SIZE];
+	uint16_t c;
+	uint8_t n;
+	uint8_t i;
+	clock_t start;
+
+	if (random8(&consumer_seed) % 8 == 0) {
+		// busy elsewhere until the ring is full
+		start = clock();
+		while ((ring_count() < RING_SIZE - 1) &&
+				(clock() - start < CLOCKS_PER_SEC / 100)) {
+			;
+		}
+	}
+	switch (random8(&consumer_seed) % 4) {
+		case 0:
+			c = ring_get();
+			if (c != RING_NO_DATA) {
+				check("get", c);
+			}
+			break;
+		case 1:
+			n = ring_read(buf, 1 + random8(&consumer_seed) % RING_SIZE);
+			for (i = 0; i < n; i++) {
+				check("read", buf[i]);
+			}
+			break;
+		case 2:
+			n = ring_count();
+			if (n >= RING_SIZE) {
+				fail("count", n);
+			}
+			for (i = 0; i < n; i++) {
+				if (ring_peek(i) != (uint8_t)(expected + i)) {
+					fail("peek", ring_peek(i));
+				}
+			}
+			ring_skip(n);
+			expected += n;
+			consumed += n;
+			break;
+		default:
+			i = random8(&consumer_seed) % 4;
+			n = ring_find(expected + i);
+			if ((n != 0) && (n != i + 1)) {
+				fail("find", n);
+			}
+			ring_skip(n);
+			expected += n;
+			consumed += n;
+			break;
+	}
+}
+
+
+
+static void set_timer(long us) {
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = us;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+
+
+int main(int argc, char *argv[]) {
+	unsigned long frames = 20000;
+	struct sigaction action;
+	time_t start;
+	uint16_t c;
+
+	if ((argc == 3) && (strcmp(argv[1], "-n") == 0)) {
+		frames = atol(argv[2]);
+	}
+	else if (argc != 1) {
+		fprintf(stderr, "usage: ringtest [-n frames]\n");
+		return 2;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = interrupt;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+	start = time(NULL);
+	set_timer(50);
+	while ((committed < frames) && !producer_error && (failures == 0) &&
+			(time(NULL) - start < MAX_SECONDS)) {
+		consume();
+	}
+	set_timer(0);
+
+	// what is left, staged chars of an unfinished frame are not seen
+	while ((c = ring_get()) != RING_NO_DATA) {
+		check("rest", c);
+	}
+	if (producer_error) {
+		printf("FAIL producer, ringtest.c line %d\n", producer_error);
+		failures++;
+	}
+	if (consumed != published) {
+		printf("FAIL read %lu chars, %lu published\n", consumed, published);
+		failures++;
+	}
+	if ((committed == 0) || (discarded == 0) || (full == 0)) {
+		printf("FAIL too few interrupts, %lu frames\n", committed);
+		failures++;
+	}
+	printf("ringtest: %lu frames, %lu dropped, %lu full, %lu chars read, %s\n",
+		committed, discarded, full, consumed, failures ? "failed" : "ok");
+	return failures ? 1 : 0;
+}
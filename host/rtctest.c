@@ -0,0 +1,120 @@
+/* ----------------------------------------------------
+ * File    : rtctest.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host test of the date conversion in rtc.c. rtc_make() is checked
+ * against days counted one by one for every day of 2000..2099, the
+ * years the GPS can give, and rtc_split() has to give the date
+ * back. Some edges are checked on their own: leap days, year ends
+ * and 2089/2090, where year * 365 no longer fits a 16 bit int.
+ *
+ * Usage:
+ *   rtctest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "rtc.h"
+
+static int failures = 0;
+static int checked = 0;
+
+
+
+// rtc.c reads the tick for the clock, not for the conversion
+uint32_t timer_millis(void) {
+	return 0;
+}
+
+
+
+static int leap(int year) {
+	return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+}
+
+
+
+static int days_of_month(int year, int month) {
+	static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	return days[month - 1] + ((month == 2) && leap(year));
+}
+
+
+
+static void set(rtc_time *t, int year, int month, int day,
+		int hour, int minute, int second) {
+	t->year = year - 2000;
+	t->month = month;
+	t->day = day;
+	t->hour = hour;
+	t->minute = minute;
+	t->second = second;
+}
+
+
+
+/*
+ * Converts the time and back, the result has to be utc.
+ */
+static void check(const char *name, rtc_time *t, uint32_t utc) {
+	rtc_time back;
+	uint32_t got = rtc_make(t);
+	checked++;
+	if (got != utc) {
+		printf("FAIL %s %04d-%02d-%02d: rtc_make %lu, expected %lu\n", name,
+			2000 + t->year, t->month, t->day,
+			(unsigned long)got, (unsigned long)utc);
+		failures++;
+		return;
+	}
+	rtc_split(utc, &back);
+	if (memcmp(&back, t, sizeof(back)) != 0) {
+		printf("FAIL %s %04d-%02d-%02d: rtc_split %04d-%02d-%02d %02d:%02d:%02d\n",
+			name, 2000 + t->year, t->month, t->day, 2000 + back.year,
+			back.month, back.day, back.hour, back.minute, back.second);
+		failures++;
+	}
+}
+
+
+
+static void check_edge(const char *name, int year, int month, int day,
+		int hour, int minute, int second, uint32_t utc) {
+	rtc_time t;
+	set(&t, year, month, day, hour, minute, second);
+	check(name, &t, utc);
+}
+
+
+
+int main(void) {
+	rtc_time t;
+	uint32_t days = 0;
+	int year, month, day;
+
+	for (year = 2000; year < 2100; year++) {
+		for (month = 1; month <= 12; month++) {
+			for (day = 1; day <= days_of_month(year, month); day++) {
+				set(&t, year, month, day, 23, 59, 59);
+				check("day", &t, days * 86400L + 86399L);
+				days++;
+			}
+		}
+	}
+
+	check_edge("start", 2000, 1, 1, 0, 0, 0, 0);
+	check_edge("leap day 2000", 2000, 2, 29, 12, 0, 0, 59 * 86400L + 43200L);
+	check_edge("after leap day 2000", 2000, 3, 1, 0, 0, 0, 60 * 86400L);
+	check_edge("no leap day 2001", 2001, 3, 1, 0, 0, 0, (366 + 59) * 86400L);
+	check_edge("end of 2089", 2089, 12, 31, 23, 59, 59, 32873 * 86400L - 1);
+	check_edge("start of 2090", 2090, 1, 1, 0, 0, 0, 32873 * 86400L);
+	check_edge("leap day 2096", 2096, 2, 29, 0, 0, 0, (35064 + 59) * 86400L);
+	check_edge("after leap day 2096", 2096, 3, 1, 0, 0, 0, (35064 + 60) * 86400L);
+	check_edge("end of 2099", 2099, 12, 31, 23, 59, 59, 36525 * 86400L - 1);
+
+	printf("rtctest: %d dates ok, %d failed\n", checked - failures, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+/* ----------------------------------------------------
+ * File    : eeprom.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host shim of avr/eeprom.h. The EEPROM is ordinary data, it starts
+ * out cleared instead of erased.
+ */
+
+#ifndef SHIM_AVR_EEPROM_H_
+#define SHIM_AVR_EEPROM_H_
+
+#include <string.h>
+
+#define EEMEM
+
+#define eeprom_read_block(dst, src, n)	memcpy((dst), (src), (n))
+
+#endif /*SHIM_AVR_EEPROM_H_*/
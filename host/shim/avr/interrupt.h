@@ -0,0 +1,21 @@
+/* ----------------------------------------------------
+ * File    : interrupt.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host shim of avr/interrupt.h. A handler is a plain function the
+ * host tool calls, e.g. USART_RXC_vect() after it set UDR.
+ */
+
+#ifndef SHIM_AVR_INTERRUPT_H_
+#define SHIM_AVR_INTERRUPT_H_
+
+#define SIGNAL(vector) void vector(void)
+
+#define cli()
+#define sei()
+
+void USART_RXC_vect(void);
+void USART_UDRE_vect(void);
+
+#endif /*SHIM_AVR_INTERRUPT_H_*/
@@ -0,0 +1,40 @@
+/* ----------------------------------------------------
+ * File    : io.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host shim of avr/io.h for the firmware modules built by the host
+ * tools. The registers are plain variables, defined by the tool.
+ */
+
+#ifndef SHIM_AVR_IO_H_
+#define SHIM_AVR_IO_H_
+
+#include <inttypes.h>
+
+extern volatile uint8_t UDR;
+extern volatile uint8_t UCSRA;
+extern volatile uint8_t UCSRB;
+extern volatile uint8_t UCSRC;
+extern volatile uint8_t UBRRH;
+extern volatile uint8_t UBRRL;
+extern volatile uint8_t SREG;
+
+// UCSRA
+#define RXC		7
+#define TXC		6
+#define UDRE	5
+#define FE		4
+#define DOR		3
+#define U2X		1
+// UCSRB
+#define RXCIE	7
+#define TXCIE	6
+#define UDRIE	5
+#define RXEN	4
+#define TXEN	3
+// UCSRC
+#define URSEL	7
+#define UCSZ0	1
+
+#endif /*SHIM_AVR_IO_H_*/
@@ -0,0 +1,29 @@
+/* ----------------------------------------------------
+ * File    : pgmspace.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host shim of avr/pgmspace.h. Flash data is ordinary data, a read
+ * keeps the type of what it reads, so a pointer read by 
+ * pgm_read_word() stays a whole pointer.
+ */
+
+#ifndef SHIM_AVR_PGMSPACE_H_
+#define SHIM_AVR_PGMSPACE_H_
+
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p)	(*(p))
+#define pgm_read_word(p)	(*(p))
+#define pgm_read_dword(p)	(*(p))
+
+#define memcpy_P	memcpy
+#define strcpy_P	strcpy
+#define strlen_P	strlen
+#define strstr_P	strstr
+#define strncmp_P	strncmp
+
+#endif /*SHIM_AVR_PGMSPACE_H_*/
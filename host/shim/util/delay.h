@@ -0,0 +1,15 @@
+/* ----------------------------------------------------
+ * File    : delay.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Software: gcc, POSIX
+ *
+ * Host shim of util/delay.h, the host tools do not wait.
+ */
+
+#ifndef SHIM_UTIL_DELAY_H_
+#define SHIM_UTIL_DELAY_H_
+
+#define _delay_ms(ms)
+#define _delay_us(us)
+
+#endif /*SHIM_UTIL_DELAY_H_*/
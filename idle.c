@@ -0,0 +1,86 @@
+/* ----------------------------------------------------
+ * File    : idle.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Idle sleep until an interrupt delivers something to do.
+ * Interrupts that do not call IDLE_WAKEUP (soft UART bit samples,
+ * UART transmit, EEPROM ready) just send the CPU back to sleep.
+ */
+
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include "idle.h"
+#include "timer.h"
+
+#define CYCLES_PER_MS (F_CPU / 1000)
+
+
+volatile uint8_t idle_source = WAKE_NONE;
+uint32_t idle_wakeups[WAKE_COUNT];
+
+static uint32_t sleep_ms = 0;
+static uint16_t sleep_cycles = 0;
+
+
+
+/*
+ * init_idle
+ */
+void init_idle(void) {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+
+
+/*
+ * idle_sleep
+ * The source is checked with interrupts disabled. sei() executes
+ * the following sleep instruction before any interrupt, so no
+ * wakeup gets lost in between.
+ * Timer 0 wakes us at least once per overflow, so the time slept
+ * in one go is always less than 256 timer counts.
+ */
+uint8_t idle_sleep(void) {
+	uint8_t source;
+	uint8_t start;
+	uint8_t slept;
+	cli();
+	start = TCNT0;
+	while (idle_source == WAKE_NONE) {
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+	}
+	slept = TCNT0 - start;
+	source = idle_source;
+	idle_source = WAKE_NONE;
+	sei();
+
+	idle_wakeups[source]++;
+	sleep_cycles += slept * TIMER_PRESCALER;
+	while (sleep_cycles >= CYCLES_PER_MS) {
+		sleep_cycles -= CYCLES_PER_MS;
+		sleep_ms++;
+	}
+	return source;
+}
+
+
+
+/*
+ * idle_duty
+ */
+uint8_t idle_duty(void) {
+	uint32_t total = timer_millis() / 100;
+	if (total == 0) {
+		return 100;
+	}
+	return 100 - (uint8_t)(sleep_ms / total);
+}
+
@@ -0,0 +1,51 @@
+/* ----------------------------------------------------
+ * File    : idle.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Idle sleep until an interrupt delivers something to do.
+ */
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include <inttypes.h>
+
+// wakeup sources
+#define WAKE_NONE	0
+#define WAKE_TIMER	1	// timer 0 tick
+#define WAKE_UART	2	// char from the modem
+#define WAKE_SUART	3	// char from the PC
+#define WAKE_COUNT	4
+
+extern volatile uint8_t idle_source;
+extern uint32_t idle_wakeups[WAKE_COUNT];
+
+/*
+ * IDLE_WAKEUP
+ * Used by interrupt handlers to end idle_sleep().
+ */
+#define IDLE_WAKEUP(source) idle_source = (source)
+
+/*
+ * init_idle
+ * Selects the idle sleep mode, timers and UARTs keep running.
+ */
+void init_idle(void);
+
+/*
+ * idle_sleep
+ * Sleeps until one of the interrupts calls IDLE_WAKEUP. Returns at
+ * once if that happened since the last call.
+ * return	uint8_t	the wakeup source
+ */
+uint8_t idle_sleep(void);
+
+/*
+ * idle_duty
+ * return	uint8_t	percentage of time the CPU was awake
+ */
+uint8_t idle_duty(void);
+
+#endif /*IDLE_H_*/
@@ -0,0 +1,56 @@
+/* ----------------------------------------------------
+ * File    : pool.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Pool of static buffers, see pool.h. 
+ * The RAM they leave for the stack is checked after linking, see 
+ * ram.h.
+ */
+
+#include <inttypes.h>
+#include "pool.h"
+
+static char pool[POOL_BUFFERS][POOL_BUFFER_SIZE];
+static uint8_t used = 0;		// bit per buffer
+static uint8_t held = 0;
+
+uint8_t pool_peak = 0;
+uint16_t pool_misses = 0;
+
+
+
+/*
+ * pool_acquire
+ */
+char *pool_acquire(void) {
+	uint8_t i;
+	for (i = 0; i < POOL_BUFFERS; i++) {
+		if (!(used & (1 << i))) {
+			used |= (1 << i);
+			if (++held > pool_peak) {
+				pool_peak = held;
+			}
+			return pool[i];
+		}
+	}
+	pool_misses++;
+	return 0;
+}
+
+
+
+/*
+ * pool_release
+ */
+void pool_release(void *buf) {
+	uint8_t i;
+	for (i = 0; i < POOL_BUFFERS; i++) {
+		if ((buf == pool[i]) && (used & (1 << i))) {
+			used &= ~(1 << i);
+			held--;
+			return;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/* ----------------------------------------------------
+ * File    : pool.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Pool of static buffers for modem responses and messages. The
+ * buffers replace large arrays on the stack, so the worst case
+ * stack no longer is the sum of all buffers along a call chain.
+ * At most two buffers are held at a time: a message and the 
+ * response while it is sent.
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <inttypes.h>
+#include "uart.h"
+#include "capture.h"
+
+#define POOL_BUFFERS		2
+#define POOL_BUFFER_SIZE	160		// an SMS, a $GPSACP response
+
+/*
+ * The large buffers must leave room for the other static variables,
+ * at least 200 bytes, and STACK_SIZE of the makefile in the 1K RAM.
+ * This catches a buffer grown too far at compile time, the makefile
+ * checks the real static RAM after linking.
+ */
+#define POOL_RAM_SIZE		1024
+#define POOL_RAM_STACK		200		// STACK_SIZE of the makefile
+#define POOL_RAM_OTHER		200
+#define POOL_RAM_BUFFERS	(POOL_BUFFERS * POOL_BUFFER_SIZE + \
+	UART_RX_BUFFER_SIZE + UART_TX_BUFFER_SIZE + CAPTURE_RAM)
+#if (POOL_RAM_BUFFERS > POOL_RAM_SIZE - POOL_RAM_STACK - POOL_RAM_OTHER)
+	#error pool, UART rings and capture ring do not fit into the RAM
+#endif
+
+extern uint8_t pool_peak;			// most buffers held at a time
+extern uint16_t pool_misses;		// acquire found no free buffer
+
+/*
+ * pool_acquire
+ * return	char*	a buffer of POOL_BUFFER_SIZE bytes, 0 if none is free
+ */
+char *pool_acquire(void);
+
+/*
+ * pool_release
+ * Returns a buffer to the pool, 0 is ignored.
+ */
+void pool_release(void *buf);
+
+#endif /*POOL_H_*/
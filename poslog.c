@@ -0,0 +1,98 @@
+/* ----------------------------------------------------
+ * File    : poslog.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Log of the last positions, see poslog.h.
+ * There is no head pointer in EEPROM, it would be written with
+ * every record. Instead each record carries a sequence number and
+ * the newest one is searched at start.
+ */
+
+#include <inttypes.h>
+#include <avr/eeprom.h>
+#include "poslog.h"
+#include "eeq.h"
+
+#define SEQ_EMPTY 0xffff
+
+
+poslog_record poslog_ee[POSLOG_SIZE] EEMEM;
+
+static uint8_t head = 0;		// next slot to write
+static uint8_t count = 0;
+static uint16_t seq = 0;		// sequence number of the next record
+
+
+
+/*
+ * poslog_init
+ */
+void poslog_init(void) {
+	uint8_t i = 0;
+	uint16_t s;
+	uint16_t newest = 0;
+	eeq_flush();
+	head = 0;
+	count = 0;
+	for (i = 0; i < POSLOG_SIZE; i++) {
+		s = eeprom_read_word(&poslog_ee[i].seq);
+		if (s == SEQ_EMPTY) {
+			continue;
+		}
+		// compare with the signed difference, seq wraps around
+		if ((count == 0) || ((int16_t)(s - newest) > 0)) {
+			newest = s;
+			head = i + 1;
+		}
+		count++;
+	}
+	if (head == POSLOG_SIZE) {
+		head = 0;
+	}
+	seq = (count == 0) ? 0 : newest + 1;
+}
+
+
+
+/*
+ * poslog_add
+ */
+void poslog_add(poslog_record *record) {
+	record->seq = seq++;
+	if (seq == SEQ_EMPTY) {
+		seq = 0;
+	}
+	eeq_write_block(record, &poslog_ee[head], sizeof(poslog_record));
+	if (++head == POSLOG_SIZE) {
+		head = 0;
+	}
+	if (count < POSLOG_SIZE) {
+		count++;
+	}
+}
+
+
+
+/*
+ * poslog_count
+ */
+uint8_t poslog_count(void) {
+	return count;
+}
+
+
+
+/*
+ * poslog_read
+ */
+void poslog_read(uint8_t index, poslog_record *record) {
+	uint8_t slot = head + POSLOG_SIZE - count + index;
+	if (slot >= POSLOG_SIZE) {
+		slot -= POSLOG_SIZE;
+	}
+	eeq_flush();
+	eeprom_read_block(record, &poslog_ee[slot], sizeof(poslog_record));
+}
+
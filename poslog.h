@@ -0,0 +1,53 @@
+/* ----------------------------------------------------
+ * File    : poslog.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Log of the last positions, kept as a ring in EEPROM.
+ */
+
+#ifndef POSLOG_H_
+#define POSLOG_H_
+
+#include <inttypes.h>
+
+// number of records in the ring
+#define POSLOG_SIZE 16
+
+typedef struct {
+	uint16_t seq;			// 0xffff: empty
+	uint32_t utc;
+	uint8_t lat_deg;
+	uint32_t lat_min;
+	uint8_t lon_deg;
+	uint32_t lon_min;
+	int16_t alt;
+} poslog_record;
+
+/*
+ * poslog_init
+ * Finds the newest record in EEPROM.
+ */
+void poslog_init(void);
+
+/*
+ * poslog_add
+ * Appends a record, overwriting the oldest one if the log is full.
+ * The sequence number is set here.
+ */
+void poslog_add(poslog_record *record);
+
+/*
+ * poslog_count
+ * return	uint8_t	number of records in the log
+ */
+uint8_t poslog_count(void);
+
+/*
+ * poslog_read
+ * Reads a record, index 0 is the oldest one.
+ */
+void poslog_read(uint8_t index, poslog_record *record);
+
+#endif /*POSLOG_H_*/
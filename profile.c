@@ -0,0 +1,36 @@
+/* ----------------------------------------------------
+ * File    : profile.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Interrupt profiler, see profile.h.
+ */
+
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include "profile.h"
+
+#ifdef ISR_PROFILE
+
+profile_stat profile_stats[PROFILE_COUNT];
+
+
+
+/*
+ * profile_reset
+ */
+void profile_reset(void) {
+	uint8_t i;
+	uint8_t sreg = SREG;
+	cli();
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		profile_stats[i].count = 0;
+		profile_stats[i].latency_min = 0xffff;
+		profile_stats[i].latency_max = 0;
+		profile_stats[i].exec_max = 0;
+	}
+	SREG = sreg;
+}
+
+#endif /*ISR_PROFILE*/
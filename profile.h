@@ -0,0 +1,119 @@
+/* ----------------------------------------------------
+ * File    : profile.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Interrupt profiler, enabled by compiling with -DISR_PROFILE.
+ * Each handler records its entry latency, i.e. the cycles from the
+ * event to the first instruction of the handler body, and its 
+ * execution time. As interrupts are blocked while a handler runs,
+ * the execution time of one handler is added to the latency of all
+ * others. 
+ * Timer 1 of the soft UART runs at full clock and is used as time 
+ * base. It counts modulo OCR1A + 1 (about 420 cycles), so longer 
+ * times are only known modulo this period.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <inttypes.h>
+
+// profiled interrupts
+#define PROFILE_UART_RX		0
+#define PROFILE_UART_UDRE	1
+#define PROFILE_SUART_TX	2	// compare 1A
+#define PROFILE_SUART_START	3	// input capture 1
+#define PROFILE_SUART_BIT	4	// compare 1B
+#define PROFILE_TIMER0		5
+#define PROFILE_EEPROM		6
+#define PROFILE_COUNT		7
+
+// no event time known, only the execution time is recorded
+#define PROFILE_NO_EVENT	0xffff
+
+#ifdef ISR_PROFILE
+#define PROFILE_RAM (PROFILE_COUNT * 8)
+#else
+#define PROFILE_RAM 0
+#endif
+
+#ifdef ISR_PROFILE
+
+#include <avr/io.h>
+
+typedef struct {
+	uint16_t count;
+	uint16_t latency_min;	// cycles
+	uint16_t latency_max;
+	uint16_t exec_max;
+} profile_stat;
+
+extern profile_stat profile_stats[PROFILE_COUNT];
+
+/*
+ * profile_elapsed
+ * return	uint16_t	cycles from start to now
+ */
+static inline uint16_t profile_elapsed(uint16_t start) {
+	uint16_t now = TCNT1;
+	return (now >= start) ? now - start : now + OCR1A + 1 - start;
+}
+
+/*
+ * profile_enter
+ * latency	cycles since the event, or PROFILE_NO_EVENT
+ * return	uint16_t	the timer 1 count at entry
+ */
+static inline uint16_t profile_enter(uint8_t id, uint16_t latency) {
+	uint16_t now = TCNT1;
+	profile_stat *stat = &profile_stats[id];
+	if (latency != PROFILE_NO_EVENT) {
+		if (latency < stat->latency_min) {
+			stat->latency_min = latency;
+		}
+		if (latency > stat->latency_max) {
+			stat->latency_max = latency;
+		}
+	}
+	stat->count++;
+	return now;
+}
+
+/*
+ * profile_exit
+ */
+static inline void profile_exit(uint8_t id, uint16_t start) {
+	uint16_t exec = profile_elapsed(start);
+	if (exec > profile_stats[id].exec_max) {
+		profile_stats[id].exec_max = exec;
+	}
+}
+
+/*
+ * PROFILE_ENTER, PROFILE_ENTER_LATENCY, PROFILE_EXIT
+ * Put at the begin and end of an interrupt handler. The event is 
+ * the timer 1 count when the interrupt was raised, if the latency 
+ * is known otherwise it is given in cycles.
+ */
+#define PROFILE_ENTER(id, event) uint16_t profile_start = profile_enter((id), \
+	((event) == PROFILE_NO_EVENT) ? PROFILE_NO_EVENT : profile_elapsed(event))
+#define PROFILE_ENTER_LATENCY(id, latency) \
+	uint16_t profile_start = profile_enter((id), (latency))
+#define PROFILE_EXIT(id) profile_exit((id), profile_start)
+
+/*
+ * profile_reset
+ */
+void profile_reset(void);
+
+#else
+
+#define PROFILE_ENTER(id, event)
+#define PROFILE_ENTER_LATENCY(id, latency)
+#define PROFILE_EXIT(id)
+
+#endif /*ISR_PROFILE*/
+
+#endif /*PROFILE_H_*/
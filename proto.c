@@ -0,0 +1,155 @@
+/* ----------------------------------------------------
+ * File    : proto.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Framed binary protocol on the soft UART, see proto.h.
+ */
+
+#include <inttypes.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+#include "proto.h"
+#include "suart.h"
+#include "timer.h"
+#include "pool.h"
+
+// max gap between two bytes of a frame [ms]
+#define PROTO_BYTE_TIMEOUT 50
+
+
+
+/*
+ * Reads a byte with timeout.
+ * return	int	the byte or -1
+ */
+static int proto_getc(void) {
+	uint32_t start = timer_millis();
+	int c;
+	while ((c = suart_getc_nowait()) == -1) {
+		if ((timer_millis() - start) > PROTO_BYTE_TIMEOUT) {
+			break;
+		}
+	}
+	return c;
+}
+
+
+
+/*
+ * Sends a byte and updates the crc.
+ */
+static uint16_t proto_putc(uint16_t crc, uint8_t c) {
+	suart_putc(c);
+	return _crc16_update(crc, c);
+}
+
+
+
+/*
+ * proto_send
+ */
+void proto_send(uint8_t command, const void *payload, uint8_t length) {
+	const uint8_t *p = payload;
+	uint16_t crc = 0xffff;
+	suart_putc(PROTO_SOF);
+	crc = proto_putc(crc, length);
+	crc = proto_putc(crc, command);
+	while (length--) {
+		crc = proto_putc(crc, *p++);
+	}
+	suart_putc(crc & 0xff);
+	suart_putc(crc >> 8);
+}
+
+
+
+/*
+ * proto_nak
+ */
+void proto_nak(uint8_t error) {
+	proto_send(PROTO_NAK | PROTO_REPLY, &error, 1);
+}
+
+
+
+/*
+ * Receives the rest of a frame into payload.
+ * return	uint8_t	0, or the error to answer with a NAK
+ */
+static uint8_t proto_receive(uint8_t *payload, uint8_t *length, uint8_t *command) {
+	uint16_t crc = 0xffff;
+	uint8_t i = 0;
+	int c;
+
+	// length, command and payload
+	for (i = 0; i < 2; i++) {
+		if ((c = proto_getc()) == -1) {
+			return PROTO_ERR_TIMEOUT;
+		}
+		crc = _crc16_update(crc, c);
+		payload[i] = c;
+	}
+	*length = payload[0];
+	*command = payload[1];
+	if (*length > PROTO_MAX_PAYLOAD) {
+		return PROTO_ERR_PAYLOAD;
+	}
+	for (i = 0; i < *length; i++) {
+		if ((c = proto_getc()) == -1) {
+			return PROTO_ERR_TIMEOUT;
+		}
+		crc = _crc16_update(crc, c);
+		payload[i] = c;
+	}
+	// crc, low byte first, a correct frame gives 0
+	for (i = 0; i < 2; i++) {
+		if ((c = proto_getc()) == -1) {
+			return PROTO_ERR_TIMEOUT;
+		}
+		crc = _crc16_update(crc, c);
+	}
+	if (crc != 0) {
+		return PROTO_ERR_CRC;
+	}
+	return 0;
+}
+
+
+
+/*
+ * proto_handle
+ * The payload is held in a pool buffer. If none is free, the frame 
+ * is skipped so it isn't taken for menu keys.
+ */
+void proto_handle(const proto_command *commands, uint8_t count) {
+	uint8_t *payload = (uint8_t *)pool_acquire();
+	uint8_t length;
+	uint8_t command;
+	uint8_t error;
+	uint8_t i = 0;
+
+	if (!payload) {
+		while (proto_getc() != -1) {
+			;
+		}
+		proto_nak(PROTO_ERR_BUSY);
+		return;
+	}
+	if ((error = proto_receive(payload, &length, &command)) == 0) {
+		error = PROTO_ERR_COMMAND;
+		for (i = 0; i < count; i++) {
+			if (commands[i].command == command) {
+				wdt_reset();
+				commands[i].work(payload, length);
+				error = 0;
+				break;
+			}
+		}
+	}
+	pool_release(payload);
+	if (error) {
+		proto_nak(error);
+	}
+}
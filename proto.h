@@ -0,0 +1,69 @@
+/* ----------------------------------------------------
+ * File    : proto.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Framed binary protocol on the soft UART, used by host tools
+ * next to the text menu.
+ *
+ * Frame: SOF, length, command, payload[length], crc low, crc high
+ * The CRC16 (poly 0xa001, init 0xffff) covers length, command and 
+ * payload. Answers have bit 7 of the command set.
+ */
+
+#ifndef PROTO_H_
+#define PROTO_H_
+
+#include <inttypes.h>
+
+#define PROTO_VERSION		1
+
+// start of frame, not a menu key
+#define PROTO_SOF			0xa5
+#define PROTO_MAX_PAYLOAD	80
+#define PROTO_REPLY			0x80
+
+// commands
+#define PROTO_STATUS		0x01
+#define PROTO_CONFIG_READ	0x02
+#define PROTO_CONFIG_WRITE	0x03
+#define PROTO_LOG_READ		0x04
+#define PROTO_ZONE_READ		0x05
+#define PROTO_ZONE_WRITE	0x06
+#define PROTO_CAPTURE		0x07	// only with UART_CAPTURE
+#define PROTO_CAPTURE_READ	0x08
+#define PROTO_NAK			0x7f
+
+// NAK codes
+#define PROTO_ERR_CRC		1
+#define PROTO_ERR_TIMEOUT	2
+#define PROTO_ERR_COMMAND	3
+#define PROTO_ERR_PAYLOAD	4
+#define PROTO_ERR_BUSY		5		// no buffer free, try again
+
+typedef struct {
+	uint8_t command;
+	void (*work)(uint8_t *payload, uint8_t length);
+} proto_command;
+
+/*
+ * proto_handle
+ * Reads the rest of a frame after the SOF was received and calls
+ * the handler of the command. Sends a NAK on errors.
+ */
+void proto_handle(const proto_command *commands, uint8_t count);
+
+/*
+ * proto_send
+ * Sends a frame.
+ */
+void proto_send(uint8_t command, const void *payload, uint8_t length);
+
+/*
+ * proto_nak
+ * Sends a NAK with the given error code.
+ */
+void proto_nak(uint8_t error);
+
+#endif /*PROTO_H_*/
@@ -0,0 +1,67 @@
+/* ----------------------------------------------------
+ * File    : ram.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * RAM check, see ram.h.
+ */
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include "ram.h"
+
+#define RAM_PAINT	0xc5
+
+// from the linker script
+extern uint8_t __data_start;
+extern uint8_t __heap_start;
+
+void ram_paint(void) __attribute__((naked, section(".init1")));
+
+
+
+/*
+ * ram_paint
+ * Fills the RAM from the end of the variables to the top of the 
+ * stack. Runs before the stack pointer and r1 are set up, so it
+ * uses neither.
+ */
+void ram_paint(void) {
+	__asm__ volatile (
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (RAM_PAINT));
+}
+
+
+
+/*
+ * ram_static
+ */
+uint16_t ram_static(void) {
+	return (uint16_t)&__heap_start - (uint16_t)&__data_start;
+}
+
+
+
+/*
+ * ram_stack_unused
+ */
+uint16_t ram_stack_unused(void) {
+	const uint8_t *p = &__heap_start;
+	uint16_t count = 0;
+	while ((p <= (const uint8_t *)RAMEND) && (*p == RAM_PAINT)) {
+		p++;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,32 @@
+/* ----------------------------------------------------
+ * File    : ram.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * RAM check. The static variables of all modules end at 
+ * __heap_start, the rest of the RAM up to RAMEND is the stack, 
+ * malloc() is not used. The makefile checks after linking that 
+ * STACK_SIZE bytes are left for the stack. At reset the stack is 
+ * painted before the variables are set up, so the bytes it never 
+ * reached can be counted while running.
+ */
+
+#ifndef RAM_H_
+#define RAM_H_
+
+#include <inttypes.h>
+
+/*
+ * ram_static
+ * return	uint16_t	bytes of the static variables, data and bss
+ */
+uint16_t ram_static(void);
+
+/*
+ * ram_stack_unused
+ * return	uint16_t	bytes of the stack never used since the reset
+ */
+uint16_t ram_stack_unused(void);
+
+#endif /*RAM_H_*/
@@ -0,0 +1,207 @@
+/* ----------------------------------------------------
+ * File    : remote.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Commands received by SMS, see remote.h.
+ */
+
+#include <inttypes.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "remote.h"
+#include "config.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+#define MASTER_MIN_DIGITS 6
+
+const char cmgl_P[] PROGMEM = "+CMGL: ";
+const char where_cmd_P[] PROGMEM = "WHERE";
+const char interval_cmd_P[] PROGMEM = "SET INTERVAL ";
+const char gateway_cmd_P[] PROGMEM = "SET GATEWAY ";
+const char pin_cmd_P[] PROGMEM = "SET PIN ";
+const char error_reply_P[] PROGMEM = "ERROR ";
+
+uint16_t remote_commands = 0;
+uint16_t remote_rejected = 0;
+
+
+
+/*
+ * remote_clear
+ */
+void remote_clear(remote_message *msg) {
+	msg->index = 0;
+	msg->lines = 0;
+	msg->sender[0] = 0;
+	msg->text[0] = 0;
+	msg->reply[0] = 0;
+}
+
+
+
+/*
+ * Copies the string up to the first CR, LF or quote, upper case.
+ */
+static void copy_field(char *dst, const char *src, uint8_t size) {
+	uint8_t i;
+	for (i = 0; (i < size - 1) && *src && (*src != '\r') && (*src != '\n') && 
+			(*src != '"'); i++) {
+		*dst++ = toupper(*src++);
+	}
+	*dst = 0;
+}
+
+
+
+/*
+ * remote_parse_line
+ */
+uint8_t remote_parse_line(const char *line, void *context) {
+	remote_message *msg = (remote_message *)context;
+	const char *p;
+	uint8_t quotes = 0;
+	if (msg->lines == 1) {
+		copy_field(msg->text, line, sizeof(msg->text));
+		msg->lines = 2;
+		return TRUE;
+	}
+	if ((msg->lines != 0) || (strncmp_P(line, cmgl_P, 7) != 0)) {
+		return FALSE;
+	}
+	// the sender is the field after the third quote
+	for (p = line; *p && (quotes < 3); p++) {
+		if (*p == '"') {
+			quotes++;
+		}
+	}
+	msg->index = atoi(line + 7);
+	copy_field(msg->sender, p, sizeof(msg->sender));
+	msg->lines = 1;
+	return TRUE;
+}
+
+
+
+/*
+ * The digits of an international number after the + or 00, NULL if
+ * it is not one.
+ */
+static const char *international(const char *number) {
+	const char *p;
+	if (number[0] == '+') {
+		number++;
+	}
+	else if ((number[0] == '0') && (number[1] == '0')) {
+		number += 2;
+	}
+	else {
+		return NULL;
+	}
+	for (p = number; *p; p++) {
+		if (!isdigit(*p)) {
+			return NULL;
+		}
+	}
+	return number;
+}
+
+
+
+/*
+ * remote_sender_ok
+ */
+uint8_t remote_sender_ok(const char *sender, const char *master) {
+	const char *s = international(sender);
+	const char *m = international(master);
+	return s && m && (strlen(m) >= MASTER_MIN_DIGITS) && 
+		(strcmp(s, m) == 0);
+}
+
+
+
+/*
+ * The interval after SET INTERVAL, digits only up to the end of the
+ * text. 0 if it is none or out of range.
+ */
+static uint16_t parse_interval(const char *text) {
+	char *end;
+	uint32_t interval;
+	if (!isdigit(*text)) {
+		return 0;
+	}
+	interval = strtoul(text, &end, 10);
+	if ((*end != 0) || (interval < CONFIG_INTERVAL_MIN) || 
+			(interval > CONFIG_INTERVAL_MAX)) {
+		return 0;
+	}
+	return interval;
+}
+
+
+
+/*
+ * Answer to a value that was not taken: ERROR, the command and, for
+ * the interval, the range.
+ */
+static void reply_error(remote_message *msg, uint8_t range) {
+	char *p;
+	strcpy_P(msg->reply, error_reply_P);
+	strcat(msg->reply, msg->text);
+	if (range) {
+		p = msg->reply + strlen(msg->reply);
+		*p++ = ' ';
+		utoa(CONFIG_INTERVAL_MIN, p, 10);
+		strcat(p, "..");
+		utoa(CONFIG_INTERVAL_MAX, p + strlen(p), 10);
+	}
+}
+
+
+
+/*
+ * remote_command
+ */
+uint8_t remote_command(remote_message *msg) {
+	const char *text = msg->text;
+	uint16_t interval = 0;
+	if (!remote_sender_ok(msg->sender, config.master)) {
+		remote_rejected++;
+		return REMOTE_UNKNOWN;
+	}
+	if (strcmp_P(text, where_cmd_P) == 0) {
+		remote_commands++;
+		return REMOTE_WHERE;
+	}
+	if (strncmp_P(text, interval_cmd_P, 13) == 0) {
+		interval = parse_interval(text + 13);
+		if (!interval) {
+			reply_error(msg, TRUE);
+			remote_rejected++;
+			return REMOTE_INVALID;
+		}
+		config.report_interval = interval;
+	}
+	else if ((strncmp_P(text, gateway_cmd_P, 12) == 0) && text[12]) {
+		strncpy(config.sms_gateway, text + 12, CONFIG_NUMBER_SIZE - 1);
+		config.sms_gateway[CONFIG_NUMBER_SIZE - 1] = 0;
+	}
+	else if ((strncmp_P(text, pin_cmd_P, 8) == 0) && text[8]) {
+		strncpy(config.pin, text + 8, CONFIG_PIN_SIZE - 1);
+		config.pin[CONFIG_PIN_SIZE - 1] = 0;
+	}
+	else {
+		remote_rejected++;
+		return REMOTE_UNKNOWN;
+	}
+	config_save();
+	remote_commands++;
+	return REMOTE_SET;
+}
@@ -0,0 +1,78 @@
+/* ----------------------------------------------------
+ * File    : remote.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Commands received by SMS. The inbox is listed in text mode with 
+ * AT+CMGL="ALL", a message is two lines:
+ * +CMGL: 1,"REC UNREAD","+491701234567",,"07/07/13,12:06:31+08"
+ * SET INTERVAL 300
+ * Only messages from the configured master number are obeyed. The
+ * master is an international number, +491701234567 or 00491701234567,
+ * and has to be the whole sender. Senders in national format are 
+ * not obeyed.
+ * Commands, upper or lower case:
+ *   WHERE					report the position now
+ *   SET INTERVAL <s>		report interval, CONFIG_INTERVAL_MIN..MAX
+ *   SET GATEWAY <number>	where the reports are sent
+ *   SET PIN <pin>			SIM pin, used with the next init
+ * WHERE is answered by the next report, it goes to the gateway like
+ * all reports. SET INTERVAL with a value that is not a number in the
+ * range is answered to the sender with ERROR, the command and the 
+ * range.
+ */
+
+#ifndef REMOTE_H_
+#define REMOTE_H_
+
+#include <inttypes.h>
+#include "config.h"
+
+#define REMOTE_TEXT_SIZE	32
+#define REMOTE_REPLY_SIZE	(REMOTE_TEXT_SIZE + 20)
+
+// results of remote_command()
+#define REMOTE_UNKNOWN	0
+#define REMOTE_WHERE	1
+#define REMOTE_SET		2
+#define REMOTE_INVALID	3	// value not taken, the answer is in reply
+
+typedef struct {
+	uint8_t index;					// 0: no message
+	uint8_t lines;					// lines of the message seen
+	char sender[CONFIG_NUMBER_SIZE];
+	char text[REMOTE_TEXT_SIZE];
+	char reply[REMOTE_REPLY_SIZE];
+} remote_message;
+
+extern uint16_t remote_commands;	// obeyed
+extern uint16_t remote_rejected;	// unknown sender or command, bad value
+
+/*
+ * remote_clear
+ */
+void remote_clear(remote_message *msg);
+
+/*
+ * remote_parse_line
+ * Takes the first message of an AT+CMGL response, line by line.
+ * return	uint8_t	TRUE if the line belonged to the message
+ */
+uint8_t remote_parse_line(const char *line, void *msg);
+
+/*
+ * remote_sender_ok
+ * return	uint8_t	TRUE if the sender is the master
+ */
+uint8_t remote_sender_ok(const char *sender, const char *master);
+
+/*
+ * remote_command
+ * Checks the sender and carries out the command. Settings are saved
+ * to the config.
+ * return	uint8_t	one of the REMOTE defines
+ */
+uint8_t remote_command(remote_message *msg);
+
+#endif /*REMOTE_H_*/
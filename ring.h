@@ -0,0 +1,146 @@
+/* ----------------------------------------------------
+ * File    : ring.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Ring buffer template for one producer and one consumer, e.g. an
+ * interrupt handler and the main loop.
+ * RING_DEFINE(name, size) defines a ring of size bytes, size must be
+ * a power of 2 up to 128, and static inline functions name_xxx().
+ *
+ * The producer stages chars with push() and publishes them with
+ * commit(), or drops them with discard(). put() does both at once.
+ * The consumer sees only published chars.
+ * The producer writes only head and fill, the consumer only tail.
+ * The indices are single bytes, so their loads and stores are atomic
+ * on the AVR. All fields are volatile, so a char is stored before
+ * the index that publishes it, and read before the index that frees
+ * its slot. No interrupts have to be blocked.
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include <inttypes.h>
+
+#define RING_NO_DATA 0x0100
+
+#define RING_DEFINE(name, size) \
+	\
+	typedef char name##_size_check[((size) & ((size) - 1)) || ((size) > 128) ? -1 : 1]; \
+	\
+	static struct { \
+		volatile uint8_t head;		/* end of the published chars */ \
+		volatile uint8_t fill;		/* end of the staged chars */ \
+		volatile uint8_t tail;		/* next char to read */ \
+		volatile uint8_t data[size]; \
+	} name; \
+	\
+	/* chars the consumer can read */ \
+	static inline uint8_t name##_count(void) { \
+		return (name.head - name.tail) & ((size) - 1); \
+	} \
+	\
+	/* stages a char, FALSE if the ring is full */ \
+	static inline uint8_t name##_push(uint8_t c) { \
+		uint8_t next = (name.fill + 1) & ((size) - 1); \
+		if (next == name.tail) { \
+			return 0; \
+		} \
+		name.data[name.fill] = c; \
+		name.fill = next; \
+		return 1; \
+	} \
+	\
+	/* chars staged but not yet published */ \
+	static inline uint8_t name##_pending(void) { \
+		return (name.fill - name.head) & ((size) - 1); \
+	} \
+	\
+	/* the last staged char, back 0, or the one before, back 1 */ \
+	static inline uint8_t name##_staged(uint8_t back) { \
+		return name.data[(name.fill - 1 - back) & ((size) - 1)]; \
+	} \
+	\
+	/* publishes the staged chars */ \
+	static inline void name##_commit(void) { \
+		name.head = name.fill; \
+	} \
+	\
+	/* drops the staged chars */ \
+	static inline void name##_discard(void) { \
+		name.fill = name.head; \
+	} \
+	\
+	/* stages and publishes a char, FALSE if the ring is full */ \
+	static inline uint8_t name##_put(uint8_t c) { \
+		if (!name##_push(c)) { \
+			return 0; \
+		} \
+		name##_commit(); \
+		return 1; \
+	} \
+	\
+	/* publishes as many chars as fit, returns their number */ \
+	static inline uint8_t name##_write(const uint8_t *buf, uint8_t n) { \
+		uint8_t i; \
+		for (i = 0; (i < n) && name##_push(buf[i]); i++) { \
+			; \
+		} \
+		name##_commit(); \
+		return i; \
+	} \
+	\
+	/* a char n places after the next one, without reading it */ \
+	static inline uint8_t name##_peek(uint8_t n) { \
+		return name.data[(name.tail + n) & ((size) - 1)]; \
+	} \
+	\
+	/* the next char, RING_NO_DATA if there is none */ \
+	static inline uint16_t name##_get(void) { \
+		uint8_t c; \
+		if (name.head == name.tail) { \
+			return RING_NO_DATA; \
+		} \
+		c = name.data[name.tail]; \
+		name.tail = (name.tail + 1) & ((size) - 1); \
+		return c; \
+	} \
+	\
+	/* reads up to n chars, returns their number */ \
+	static inline uint8_t name##_read(uint8_t *buf, uint8_t n) { \
+		uint8_t i; \
+		uint8_t count = name##_count(); \
+		if (n > count) { \
+			n = count; \
+		} \
+		for (i = 0; i < n; i++) { \
+			buf[i] = name.data[name.tail]; \
+			name.tail = (name.tail + 1) & ((size) - 1); \
+		} \
+		return n; \
+	} \
+	\
+	/* drops up to n chars */ \
+	static inline void name##_skip(uint8_t n) { \
+		uint8_t count = name##_count(); \
+		if (n > count) { \
+			n = count; \
+		} \
+		name.tail = (name.tail + n) & ((size) - 1); \
+	} \
+	\
+	/* chars up to and including the first c, 0 if c is not there */ \
+	static inline uint8_t name##_find(uint8_t c) { \
+		uint8_t i; \
+		uint8_t count = name##_count(); \
+		for (i = 0; i < count; i++) { \
+			if (name##_peek(i) == c) { \
+				return i + 1; \
+			} \
+		} \
+		return 0; \
+	}
+
+#endif /*RING_H_*/
@@ -0,0 +1,188 @@
+/* ----------------------------------------------------
+ * File    : rtc.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Real time clock, see rtc.h.
+ * The clock is kept as the UTC of the last fix plus the tick 
+ * elapsed since then, corrected by the estimated drift.
+ */
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+#include "rtc.h"
+#include "timer.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+// minimum time between two fixes to estimate the drift, the fix 
+// time is only known to about a second
+#define RTC_MIN_SPAN 600000L
+
+// larger errors are a step of the time, e.g. a wrong GPS date, not
+// drift. The clock is set again and the drift is kept. Also keeps
+// error * 1000 in range.
+#define RTC_MAX_ERROR 2000000L		// ms
+#define RTC_MAX_DRIFT 50000L		// ppm
+
+#define SECONDS_PER_DAY 86400L
+
+// days before the first of each month
+const uint16_t month_days_P[] PROGMEM = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+
+static uint8_t valid = FALSE;
+static uint32_t sync_utc = 0;		// UTC at the last fix
+static uint16_t sync_ms = 0;		// and its ms
+static uint32_t sync_tick = 0;		// tick at the last fix
+static int32_t drift_ppm = 0;
+static uint8_t drift_valid = FALSE;
+
+
+
+/*
+ * Wall clock ms elapsed since the last fix.
+ */
+static uint32_t rtc_elapsed(void) {
+	uint32_t elapsed = timer_millis() - sync_tick;
+	uint32_t s = elapsed / 1000;
+	int32_t correction = (int32_t)(s / 1000) * drift_ppm
+		+ ((int32_t)(s % 1000) * drift_ppm) / 1000;
+	return elapsed - correction;
+}
+
+
+
+/*
+ * rtc_sync
+ */
+void rtc_sync(uint32_t utc, uint16_t ms) {
+	uint32_t now = timer_millis();
+	uint32_t ticks = now - sync_tick;
+	int32_t error;
+	int32_t ppm = RTC_MAX_DRIFT;
+	if (valid && (ticks >= RTC_MIN_SPAN)) {
+		error = ticks - ((utc - sync_utc) * 1000 + ms - sync_ms);
+		if ((error > -RTC_MAX_ERROR) && (error < RTC_MAX_ERROR)) {
+			ppm = (error * 1000) / (int32_t)(ticks / 1000);
+		}
+		// otherwise it was a step, the clock is only set again
+		if ((ppm > -RTC_MAX_DRIFT) && (ppm < RTC_MAX_DRIFT)) {
+			drift_ppm = drift_valid ? (drift_ppm * 3 + ppm) / 4 : ppm;
+			drift_valid = TRUE;
+		}
+	}
+	if (!valid || (ticks >= RTC_MIN_SPAN)) {
+		// keep the old reference until the span is long enough
+		sync_tick = now;
+		sync_utc = utc;
+		sync_ms = ms;
+		valid = TRUE;
+	}
+}
+
+
+
+/*
+ * rtc_valid
+ */
+uint8_t rtc_valid(void) {
+	return valid;
+}
+
+
+
+/*
+ * rtc_now
+ */
+uint32_t rtc_now(void) {
+	if (!valid) {
+		return 0;
+	}
+	return sync_utc + (sync_ms + rtc_elapsed()) / 1000;
+}
+
+
+
+/*
+ * rtc_until
+ */
+uint32_t rtc_until(uint16_t interval) {
+	uint32_t ms = sync_ms + rtc_elapsed();
+	uint32_t now = sync_utc + ms / 1000;
+	uint32_t wall = (interval - now % interval) * 1000L - ms % 1000;
+	// wall clock ms --> tick ms
+	return wall + ((int32_t)(wall / 1000) * drift_ppm) / 1000;
+}
+
+
+
+/*
+ * rtc_drift
+ */
+int32_t rtc_drift(void) {
+	return drift_ppm;
+}
+
+
+
+/*
+ * rtc_make
+ */
+uint32_t rtc_make(rtc_time *time) {
+	uint8_t year = time->year;
+	uint16_t days = (uint16_t)year * 365 + (year + 3) / 4;	// no 16 bit int overflow
+	days += pgm_read_word(&month_days_P[time->month - 1]);
+	if (((year & 3) == 0) && (time->month > 2)) {
+		days++;
+	}
+	days += time->day - 1;
+	return days * SECONDS_PER_DAY 
+		+ time->hour * 3600L + time->minute * 60 + time->second;
+}
+
+
+
+/*
+ * rtc_split
+ */
+void rtc_split(uint32_t utc, rtc_time *time) {
+	uint16_t days = utc / SECONDS_PER_DAY;
+	uint32_t seconds = utc % SECONDS_PER_DAY;
+	uint16_t year_days;
+	uint8_t leap;
+	uint8_t month;
+
+	time->hour = seconds / 3600;
+	time->minute = (seconds / 60) % 60;
+	time->second = seconds % 60;
+
+	time->year = 0;
+	while (TRUE) {
+		year_days = ((time->year & 3) == 0) ? 366 : 365;
+		if (days < year_days) {
+			break;
+		}
+		days -= year_days;
+		time->year++;
+	}
+	leap = ((time->year & 3) == 0) && (days >= 59);
+	if (leap && (days == 59)) {
+		// 29th of february
+		time->month = 2;
+		time->day = 29;
+		return;
+	}
+	days -= leap;
+	for (month = 11; pgm_read_word(&month_days_P[month]) > days; month--) {
+		;
+	}
+	time->month = month + 1;
+	time->day = days - pgm_read_word(&month_days_P[month]) + 1;
+}
+
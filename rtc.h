@@ -0,0 +1,72 @@
+/* ----------------------------------------------------
+ * File    : rtc.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Real time clock, set from the GPS time on every fix. The drift
+ * of the crystal is estimated between fixes and corrected.
+ * Times are seconds since 2000-01-01 00:00:00 UTC.
+ */
+
+#ifndef RTC_H_
+#define RTC_H_
+
+#include <inttypes.h>
+
+typedef struct {
+	uint8_t year;		// 0 = 2000
+	uint8_t month;		// 1..12
+	uint8_t day;		// 1..31
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t second;
+} rtc_time;
+
+/*
+ * rtc_sync
+ * Sets the clock from a GPS fix, called right when the fix was 
+ * received. An error beyond any drift is taken as a step of the
+ * time, the clock is set without changing the drift.
+ */
+void rtc_sync(uint32_t utc, uint16_t ms);
+
+/*
+ * rtc_valid
+ * return	uint8_t	TRUE if the clock was set since start
+ */
+uint8_t rtc_valid(void);
+
+/*
+ * rtc_now
+ * return	uint32_t	current UTC, 0 if the clock is not set
+ */
+uint32_t rtc_now(void);
+
+/*
+ * rtc_until
+ * return	uint32_t	tick ms until the next UTC time that is a
+ *						multiple of interval seconds
+ */
+uint32_t rtc_until(uint16_t interval);
+
+/*
+ * rtc_drift
+ * return	int32_t	estimated drift of the tick in ppm, positive
+ *					if the tick runs fast
+ */
+int32_t rtc_drift(void);
+
+/*
+ * rtc_make
+ * Converts a date and time into seconds since 2000.
+ */
+uint32_t rtc_make(rtc_time *time);
+
+/*
+ * rtc_split
+ * Converts seconds since 2000 into date and time.
+ */
+void rtc_split(uint32_t utc, rtc_time *time);
+
+#endif /*RTC_H_*/
@@ -0,0 +1,231 @@
+/* ----------------------------------------------------
+ * File    : sms.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * SMS PDU encoding, see sms.h and GSM 03.38 / 03.40.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "sms.h"
+
+#define GSM_ESCAPE		0x1b
+#define GSM_UNKNOWN		'?'
+
+#define TOA_INTERNATIONAL	0x91
+#define TOA_UNKNOWN			0x81
+
+#define SMS_SUBMIT		0x01
+#define SMS_UDHI		0x40
+
+#define IEI_CONCAT		0x00	// concatenated message, 8 bit reference
+
+
+
+/*
+ * Converts an ASCII char to the GSM 7 bit default alphabet.
+ * Chars of the extension table are returned with bit 7 set, they
+ * have to be sent with an escape.
+ */
+static uint8_t gsm7_char(char c) {
+	switch (c) {
+		case '@': return 0x00;
+		case '$': return 0x02;
+		case '_': return 0x11;
+		case '^': return 0x80 | 0x14;
+		case '{': return 0x80 | 0x28;
+		case '}': return 0x80 | 0x29;
+		case '\\': return 0x80 | 0x2f;
+		case '[': return 0x80 | 0x3c;
+		case '~': return 0x80 | 0x3d;
+		case ']': return 0x80 | 0x3e;
+		case '|': return 0x80 | 0x40;
+		case '`': return GSM_UNKNOWN;
+		default:
+			if ((c == '\n') || (c == '\r') || ((c >= ' ') && (c <= 'z'))) {
+				return c;
+			}
+			return GSM_UNKNOWN;
+	}
+}
+
+
+
+/*
+ * sms_septets
+ */
+uint16_t sms_septets(const char *text, uint8_t n) {
+	uint16_t count = 0;
+	while (n-- && *text) {
+		count += (gsm7_char(*text++) & 0x80) ? 2 : 1;
+	}
+	return count;
+}
+
+
+
+/*
+ * sms_fit
+ */
+uint8_t sms_fit(const char *text, uint8_t septets) {
+	uint8_t n = 0;
+	uint8_t size;
+	while (text[n]) {
+		size = (gsm7_char(text[n]) & 0x80) ? 2 : 1;
+		if (size > septets) {
+			break;
+		}
+		septets -= size;
+		n++;
+	}
+	return n;
+}
+
+
+
+/*
+ * sms_parts
+ * An escape that does not fit at the end of a part leaves a septet 
+ * unused, so the parts can't be counted from the septets.
+ */
+uint8_t sms_parts(const char *text) {
+	uint8_t parts = 0;
+	while (*text) {
+		text += sms_fit(text, SMS_PART_SEPTETS);
+		parts++;
+	}
+	return parts;
+}
+
+
+
+/*
+ * Number of digits of a phone number, without '+'.
+ */
+static uint8_t number_digits(const char *number) {
+	uint8_t digits = strlen(number);
+	if (*number == '+') {
+		digits--;
+	}
+	return digits;
+}
+
+
+
+/*
+ * sms_tpdu_length
+ * first octet, MR, DA length, DA type, DA digits, PID, DCS, UDL, UD
+ */
+uint8_t sms_tpdu_length(const char *number, uint8_t ud_octets) {
+	return 1 + 1 + 2 + (number_digits(number) + 1) / 2 + 3 + ud_octets;
+}
+
+
+
+/*
+ * Puts the digits of a phone number as semi octets, low nibble 
+ * first, padded with F.
+ */
+static void put_digits(sms_sink sink, const char *number) {
+	uint8_t octet = 0;
+	uint8_t high = 0;
+	if (*number == '+') {
+		number++;
+	}
+	while (*number) {
+		if (high) {
+			sink(octet | ((*number - '0') << 4));
+		}
+		else {
+			octet = *number - '0';
+		}
+		high = !high;
+		number++;
+	}
+	if (high) {
+		sink(octet | 0xf0);
+	}
+}
+
+
+
+/*
+ * sms_header
+ */
+void sms_header(sms_sink sink, const char *smsc, const char *number, 
+		uint8_t dcs, uint8_t udl, uint8_t udhi) {
+	uint8_t digits;
+	// SMSC, length in octets including the type
+	if (*smsc) {
+		sink(1 + (number_digits(smsc) + 1) / 2);
+		sink((*smsc == '+') ? TOA_INTERNATIONAL : TOA_UNKNOWN);
+		put_digits(sink, smsc);
+	}
+	else {
+		sink(0);
+	}
+	sink(udhi ? (SMS_SUBMIT | SMS_UDHI) : SMS_SUBMIT);
+	sink(0);						// message reference, set by the phone
+	// destination, length in digits
+	digits = number_digits(number);
+	sink(digits);
+	sink((*number == '+') ? TOA_INTERNATIONAL : TOA_UNKNOWN);
+	put_digits(sink, number);
+	sink(0);						// protocol identifier
+	sink(dcs);
+	sink(udl);
+}
+
+
+
+/*
+ * sms_udh
+ */
+void sms_udh(sms_sink sink, uint8_t ref, uint8_t total, uint8_t seq) {
+	sink(5);						// header length
+	sink(IEI_CONCAT);
+	sink(3);						// element length
+	sink(ref);
+	sink(total);
+	sink(seq);
+}
+
+
+
+/*
+ * sms_pack7
+ * Septets are shifted into an accumulator, every full octet is
+ * put out.
+ */
+void sms_pack7(sms_sink sink, const char *text, uint8_t n, uint8_t fill) {
+	uint16_t acc = 0;
+	uint8_t bits = fill;
+	uint8_t septet;
+	uint8_t escape;
+	while (n-- && *text) {
+		septet = gsm7_char(*text++);
+		escape = septet & 0x80;
+		do {
+			if (escape) {
+				acc |= GSM_ESCAPE << bits;
+				escape = 0;
+			}
+			else {
+				acc |= (septet & 0x7f) << bits;
+				septet = 0;
+			}
+			bits += 7;
+			if (bits >= 8) {
+				sink(acc & 0xff);
+				acc >>= 8;
+				bits -= 8;
+			}
+		} while (septet);
+	}
+	if (bits) {
+		sink(acc & 0xff);
+	}
+}
+
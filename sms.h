@@ -0,0 +1,84 @@
+/* ----------------------------------------------------
+ * File    : sms.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * SMS PDU encoding. The PDU is produced octet by octet into a
+ * sink, so it can be streamed to the modem without a buffer.
+ */
+
+#ifndef SMS_H_
+#define SMS_H_
+
+#include <inttypes.h>
+
+// data coding schemes
+#define SMS_DCS_7BIT	0x00
+#define SMS_DCS_8BIT	0x04
+
+// max user data
+#define SMS_MAX_OCTETS	140
+#define SMS_MAX_SEPTETS	160
+
+// max user data of one part of a concatenated message, the user 
+// data header takes 6 octets
+#define SMS_PART_SEPTETS	153
+#define SMS_UDH_SEPTETS		7	// 6 octets plus 1 fill bit
+
+typedef void (*sms_sink)(uint8_t octet);
+
+/*
+ * sms_septets
+ * return	uint16_t	number of septets of the first n chars of the 
+ *						text in the GSM 7 bit alphabet, escaped chars 
+ *						count twice
+ */
+uint16_t sms_septets(const char *text, uint8_t n);
+
+/*
+ * sms_fit
+ * return	uint8_t	number of chars of the text that fit into the given
+ *					number of septets, escapes are not split
+ */
+uint8_t sms_fit(const char *text, uint8_t septets);
+
+/*
+ * sms_parts
+ * return	uint8_t	number of parts of a concatenated message, each part
+ *					takes the chars that sms_fit() gives for 
+ *					SMS_PART_SEPTETS
+ */
+uint8_t sms_parts(const char *text);
+
+/*
+ * sms_tpdu_length
+ * return	uint8_t	length of the TPDU in octets as needed for 
+ *					AT+CMGS, without the SMSC part
+ */
+uint8_t sms_tpdu_length(const char *number, uint8_t ud_octets);
+
+/*
+ * sms_header
+ * Puts the SMSC address and the TPDU up to and including the user
+ * data length. An empty smsc uses the one stored on the SIM.
+ * udl is in septets for 7 bit and in octets for 8 bit data, 
+ * including the user data header if udhi is set.
+ */
+void sms_header(sms_sink sink, const char *smsc, const char *number, 
+	uint8_t dcs, uint8_t udl, uint8_t udhi);
+
+/*
+ * sms_udh
+ * Puts the user data header of one part of a concatenated message.
+ */
+void sms_udh(sms_sink sink, uint8_t ref, uint8_t total, uint8_t seq);
+
+/*
+ * sms_pack7
+ * Converts n chars of the text to the GSM 7 bit alphabet and puts 
+ * them packed, after fill zero bits.
+ */
+void sms_pack7(sms_sink sink, const char *text, uint8_t n, uint8_t fill);
+
+#endif /*SMS_H_*/
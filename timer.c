@@ -0,0 +1,180 @@
+/* ----------------------------------------------------
+ * File    : timer.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Monotonic millisecond tick on timer 0 and software timers.
+ * The tick is kept in the overflow interrupt, the timers are 
+ * checked in the foreground, so callbacks run outside of 
+ * interrupt context.
+ */
+
+#include <inttypes.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "timer.h"
+#include "idle.h"
+#include "profile.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+// length of one timer 0 overflow in us
+// 4.096MHz: 4000us, 4MHz: 4096us
+#define OVERFLOW_US ((256UL * TIMER_PRESCALER * 1000000) / F_CPU)
+#if ((256UL * TIMER_PRESCALER * 1000000) % F_CPU)
+	#warning timer 0 overflow is not a whole number of us, clock will drift
+#endif
+
+
+typedef struct {
+	uint32_t deadline;
+	uint32_t period;
+	timer_callback callback;
+	uint8_t active;
+} soft_timer;
+
+
+static volatile uint32_t millis = 0;
+static volatile uint32_t uptime = 0;
+static volatile uint16_t us_count = 0;
+static volatile uint16_t ms_count = 0;
+
+static soft_timer timers[TIMER_COUNT];
+
+
+
+/*
+ * init_timer
+ */
+void init_timer(void) {
+	// timer 0 setup, prescaler 64
+	TCCR0 |= (1 << CS01) | (1 << CS00);
+	// enable timer 0 interrupt
+	TIMSK |= (1 << TOIE0);
+}
+
+
+
+/*
+ * SIGNAL TIMER0_OVF_vect
+ * Handles overflow interrupts of timer 0.
+ * With prescaler 64 it is called every OVERFLOW_US.
+ */
+SIGNAL(TIMER0_OVF_vect) {
+	PROFILE_ENTER_LATENCY(PROFILE_TIMER0, TCNT0 * TIMER_PRESCALER);
+	uint16_t us = us_count + OVERFLOW_US;
+	while (us >= 1000) {
+		us -= 1000;
+		millis++;
+		if (++ms_count == 1000) {
+			ms_count = 0;
+			uptime++;
+		}
+	}
+	us_count = us;
+	IDLE_WAKEUP(WAKE_TIMER);
+	PROFILE_EXIT(PROFILE_TIMER0);
+}
+
+
+
+/*
+ * timer_millis
+ */
+uint32_t timer_millis(void) {
+	uint32_t ms;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = millis;
+	}
+	return ms;
+}
+
+
+
+/*
+ * timer_uptime
+ */
+uint32_t timer_uptime(void) {
+	uint32_t s;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		s = uptime;
+	}
+	return s;
+}
+
+
+
+/*
+ * timer_start
+ */
+void timer_start(uint8_t id, uint32_t delay, uint32_t period, timer_callback callback) {
+	soft_timer *t = &timers[id];
+	t->deadline = timer_millis() + delay;
+	t->period = period;
+	t->callback = callback;
+	t->active = TRUE;
+}
+
+
+
+/*
+ * timer_stop
+ */
+void timer_stop(uint8_t id) {
+	timers[id].active = FALSE;
+}
+
+
+
+/*
+ * timer_active
+ */
+uint8_t timer_active(uint8_t id) {
+	return timers[id].active;
+}
+
+
+
+/*
+ * timer_remaining
+ */
+uint32_t timer_remaining(uint8_t id) {
+	int32_t left = timers[id].deadline - timer_millis();
+	if (!timers[id].active || (left < 0)) {
+		return 0;
+	}
+	return left;
+}
+
+
+
+/*
+ * timer_poll
+ * Compares with the signed difference, so the wrap around of the
+ * tick after 49 days does not matter.
+ */
+void timer_poll(void) {
+	uint32_t now = timer_millis();
+	soft_timer *t = timers;
+	uint8_t i = 0;
+	for (i = 0; i < TIMER_COUNT; i++, t++) {
+		if (t->active && ((int32_t)(now - t->deadline) >= 0)) {
+			if (t->period) {
+				// keep the phase, skip periods that were missed completely
+				do {
+					t->deadline += t->period;
+				} while ((int32_t)(now - t->deadline) >= 0);
+			}
+			else {
+				t->active = FALSE;
+			}
+			t->callback();
+		}
+	}
+}
+
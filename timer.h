@@ -0,0 +1,77 @@
+/* ----------------------------------------------------
+ * File    : timer.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ *
+ * Monotonic millisecond tick on timer 0 and software timers.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <inttypes.h>
+
+// timer 0 clock divider
+#define TIMER_PRESCALER 64
+
+// timer slots
+#define TIMER_MODE		0	// one shot wakeup of the main loop
+#define TIMER_REPORT	1	// periodic position report
+#define TIMER_COVERAGE	2	// periodic signal sample
+#define TIMER_COUNT		3
+
+typedef void (*timer_callback)(void);
+
+/*
+ * init_timer
+ * Starts timer 0 with prescaler 64 and enables the overflow interrupt.
+ */
+void init_timer(void);
+
+/*
+ * timer_millis
+ * return	uint32_t	milliseconds since start, read atomically
+ */
+uint32_t timer_millis(void);
+
+/*
+ * timer_uptime
+ * return	uint32_t	seconds since start
+ */
+uint32_t timer_uptime(void);
+
+/*
+ * timer_start
+ * Starts a timer in the given slot. It expires after delay ms and,
+ * if period is not 0, every period ms after that.
+ */
+void timer_start(uint8_t id, uint32_t delay, uint32_t period, timer_callback callback);
+
+/*
+ * timer_stop
+ */
+void timer_stop(uint8_t id);
+
+/*
+ * timer_active
+ * return	uint8_t	TRUE if the timer is running
+ */
+uint8_t timer_active(uint8_t id);
+
+/*
+ * timer_remaining
+ * return	uint32_t	ms until the timer expires, 0 if it is not 
+ *						running or already expired
+ */
+uint32_t timer_remaining(uint8_t id);
+
+/*
+ * timer_poll
+ * Calls the callbacks of all expired timers. Must be called from 
+ * the main loop. A timer that is polled late still fires, a late
+ * periodic timer keeps its phase.
+ */
+void timer_poll(void);
+
+#endif /*TIMER_H_*/
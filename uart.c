@@ -1,203 +1,293 @@
-/* ----------------------------------------------------
- * File    : uart.c
- * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
- * Hardware: ATmega8, 4.096MHz
- * Software: WinAVR20070525
- * 
- * Adapted from:
- * Author:   Peter Fleury <pfleury@gmx.ch>   http://jump.to/fleury
- */
-
-#include <inttypes.h>
-#include <stdio.h>
-#include <avr/interrupt.h>
-#include <avr/io.h>
-#include <avr/pgmspace.h>
-#include "uart.h"
-
-#ifndef TRUE
-#define TRUE 1
-#define FALSE 0 
-#endif
-
-
-
-#define BAUD 19200
-//#define BAUD 4800
-// 4.096MHz
-//  4800: 52.3333333
-//  9600: 25.6666667
-// 14400: 16.7777778
-// 19600: 12.06
-// 28800: 7.8889
-// 38400: 5.6667
-
-#define MYUBBR ((F_CPU / (BAUD * 16L)) - 1)
-#define TX_BUFFER_SIZE 32
-#define RX_BUFFER_SIZE 32
-#define RX_BUFFER_MASK ( RX_BUFFER_SIZE - 1 )
-#define TX_BUFFER_MASK ( TX_BUFFER_SIZE - 1 )
-#if ( RX_BUFFER_SIZE & RX_BUFFER_MASK )
-	#error RX buffer size is not a power of 2
-#endif
-#if ( TX_BUFFER_SIZE & TX_BUFFER_MASK )
-	#error TX buffer size is not a power of 2
-#endif
-
-
-static volatile uint8_t rx_buffer[RX_BUFFER_SIZE];
-static volatile uint8_t tx_buffer[TX_BUFFER_SIZE];
-static volatile uint8_t rx_head = 0;
-static volatile uint8_t rx_tail = 0;
-static volatile uint8_t tx_head = 0;
-static volatile uint8_t tx_tail = 0;
-
-
-/*
- * init_uart
- */
-void init_uart(void) {
-	// set baud rate
-	UBRRH = (uint8_t)(MYUBBR >> 8); 
-	UBRRL = (uint8_t)(MYUBBR);
-	
-	// enable receive and transmit
-	UCSRB = (1 << RXCIE) | (1 << RXEN) | (1 << TXEN);
-	// set frame format
-	UCSRC = (1 << URSEL) | (3 << UCSZ0);	// asynchron 8n1
-}
-
-
-
-/*
- * send_uart
- * Sends a single char to UART
- */
-//void send_uart(uint8_t c) {
-void _uart_putc(uint8_t c) {
-	// wait for empty data register
-	while (!(UCSRA & (1 << UDRE)));	
-	// set data into data register
-	UDR = c;
-}
-
-
-
-/*
- * uart_getc_f
- * getc in stdio style.
- */
-int uart_getc_f(FILE *stream) {
-	uint16_t c;
-	while ((c = uart_getc()) == UART_NO_DATA) {}
-	return c;
-}
-
-uint8_t uart_getc_wait(void) {
-	uint16_t c;
-	while ((c = uart_getc()) == UART_NO_DATA) {}
-	return c;
-}
-
-
-
-/*
- * uart_getc
- * Gets a single char.
- * return	uint16_r	the received char or UART_NO_DATA 
- */
-uint16_t uart_getc(void) {
-	uint8_t c = 0;
-	uint8_t tmp_tail = 0;
-	if (rx_head == rx_tail) {
-		return UART_NO_DATA;
-	}
-	tmp_tail = (rx_tail + 1) % RX_BUFFER_SIZE;
-	c = rx_buffer[rx_tail];
-	rx_tail = tmp_tail;
-	return c;
-}
-
-
-
-/*
- * SIGNAL RX complete
- * Receives a char from UART and stores it in ring buffer.
- */
-SIGNAL(USART_RXC_vect) {
-	uint8_t tmp_head = 0;
-	uint8_t data = UDR;
-	tmp_head = (rx_head + 1) % RX_BUFFER_SIZE;
-	if (tmp_head == rx_tail) {
-		// buffer overflow error!
-	}
-	else {
-		rx_buffer[rx_head] = data;
-		rx_head = tmp_head;
-	}
-}
-
-
-
-/*
- * uart_putc_f
- * Puts a single char. Used by printf functions.
- */
-int uart_putc_f(char c, FILE *stream) {
-	uart_putc(c);
-    return 0;
-}
-
-void uart_puts(const char *s) {
-    while (*s) {
-        uart_putc(*s);
-        s++;
-    }
-}
-void uart_puts_P(const char *s) {
-	while (pgm_read_byte(s) != 0x00) {
-		uart_putc(pgm_read_byte(s++));
-	}
-}
-
-
-
-/*
- * Puts a single char.
- *   uint8_t c	the char to transmit
- */
-void uart_putc(uint8_t c) {
-	uint8_t tmp_head = 0;
-	tmp_head = (tx_head + 1) & TX_BUFFER_MASK;
-	// wait for space in buffer
-	while (tmp_head == tx_tail) {
-		;
-	}
-	tx_buffer[tx_head] = c;
-	tx_head = tmp_head;
-	// enable uart data interrupt (send data)
-	UCSRB |= (1<<UDRIE);
-}
-
-
-
-/*
- * SIGNAL User Data Regiser Empty
- * Send a char out of buffer via UART. If sending is complete, the 
- * interrupt gets disabled.
- */
-SIGNAL(USART_UDRE_vect) {
-	uint8_t tmp_tail = 0;
-	if (tx_head != tx_tail) {
-		tmp_tail = (tx_tail + 1) & TX_BUFFER_MASK;
-		UDR = tx_buffer[tx_tail];
-		tx_tail = tmp_tail;
-	}
-	else {
-		// disable this interrupt if nothing more to send
-		UCSRB &= ~(1 << UDRIE);
-	}
-}
-
-
-
+/* ----------------------------------------------------
+ * File    : uart.c
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ * 
+ * Adapted from:
+ * Author:   Peter Fleury <pfleury@gmx.ch>   http://jump.to/fleury
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "uart.h"
+#include "ring.h"
+#include "idle.h"
+#include "profile.h"
+#include "capture.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0 
+#endif
+
+
+
+// UBRR rounded to the nearest value, with normal and double speed
+#define UBRR_NORMAL(baud) ((F_CPU + 8UL * (baud)) / (16UL * (baud)) - 1)
+#define UBRR_DOUBLE(baud) ((F_CPU + 4UL * (baud)) / (8UL * (baud)) - 1)
+#define REAL_NORMAL(baud) (F_CPU / (16UL * (UBRR_NORMAL(baud) + 1)))
+#define REAL_DOUBLE(baud) (F_CPU / (8UL * (UBRR_DOUBLE(baud) + 1)))
+// error of the real baud rate in permille
+#define ERROR_OF(real, baud) (((real) > (baud) ? (real) - (baud) : (baud) - (real)) \
+	* 1000UL / (baud))
+#define ERROR_NORMAL(baud) ERROR_OF(REAL_NORMAL(baud), baud)
+#define ERROR_DOUBLE(baud) ERROR_OF(REAL_DOUBLE(baud), baud)
+#define USE_DOUBLE(baud) (ERROR_DOUBLE(baud) < ERROR_NORMAL(baud))
+#define RATE_ERROR(baud) (USE_DOUBLE(baud) ? ERROR_DOUBLE(baud) : ERROR_NORMAL(baud))
+#define RATE(baud) { baud, USE_DOUBLE(baud) ? UBRR_DOUBLE(baud) : UBRR_NORMAL(baud), \
+	USE_DOUBLE(baud), RATE_ERROR(baud) > UART_MAX_ERROR ? 0xff : RATE_ERROR(baud) }
+
+#if (RATE_ERROR(19200) > UART_MAX_ERROR)
+	#error the default baud rate is not reliable with this F_CPU
+#endif
+
+typedef struct {
+	uint32_t baud;
+	uint16_t ubrr;
+	uint8_t u2x;
+	uint8_t error;		// permille, 0xff: not usable
+} uart_rate_entry;
+
+// same order as the UART_RATE defines
+const uart_rate_entry uart_rates[UART_RATES] PROGMEM = {
+	RATE(9600), RATE(19200), RATE(38400), RATE(57600), RATE(115200)
+};
+
+// the RX interrupt stages the chars of a line and publishes it when
+// it is complete, the UDRE interrupt reads from tx
+RING_DEFINE(rx, UART_RX_BUFFER_SIZE)
+RING_DEFINE(tx, UART_TX_BUFFER_SIZE)
+
+static volatile uint8_t rx_dropping = FALSE;
+
+uint16_t uart_dropped = 0;
+uint8_t uart_rate = UART_RATE_DEFAULT;
+
+
+/*
+ * init_uart
+ */
+void init_uart(void) {
+	// set baud rate
+	uart_baud(UART_RATE_DEFAULT);
+	
+	// enable receive and transmit
+	UCSRB = (1 << RXCIE) | (1 << RXEN) | (1 << TXEN);
+	// set frame format
+	UCSRC = (1 << URSEL) | (3 << UCSZ0);	// asynchron 8n1
+}
+
+
+
+/*
+ * uart_baud
+ */
+uint8_t uart_baud(uint8_t rate) {
+	uint16_t ubrr;
+	if ((rate >= UART_RATES) || 
+			(pgm_read_byte(&uart_rates[rate].error) > UART_MAX_ERROR)) {
+		return FALSE;
+	}
+	// let the last char go out with the old rate
+	uart_flush();
+	_delay_ms(2);
+	ubrr = pgm_read_word(&uart_rates[rate].ubrr);
+	UBRRH = (uint8_t)(ubrr >> 8); 
+	UBRRL = (uint8_t)(ubrr);
+	UCSRA = pgm_read_byte(&uart_rates[rate].u2x) ? (1 << U2X) : 0;
+	uart_rate = rate;
+	return TRUE;
+}
+
+
+
+/*
+ * uart_flush
+ */
+void uart_flush(void) {
+	while (tx_count() != 0) {
+		;
+	}
+	while (!(UCSRA & (1 << UDRE))) {
+		;
+	}
+}
+
+
+
+/*
+ * uart_rate_baud
+ */
+uint32_t uart_rate_baud(uint8_t rate) {
+	return pgm_read_dword(&uart_rates[rate].baud);
+}
+
+
+
+/*
+ * uart_rate_error
+ */
+uint8_t uart_rate_error(uint8_t rate) {
+	return pgm_read_byte(&uart_rates[rate].error);
+}
+
+
+
+/*
+ * send_uart
+ * Sends a single char to UART
+ */
+//void send_uart(uint8_t c) {
+void _uart_putc(uint8_t c) {
+	// wait for empty data register
+	while (!(UCSRA & (1 << UDRE)));	
+	// set data into data register
+	UDR = c;
+}
+
+
+
+/*
+ * uart_getc_f
+ * getc in stdio style.
+ */
+int uart_getc_f(FILE *stream) {
+	uint16_t c;
+	while ((c = uart_getc()) == UART_NO_DATA) {}
+	return c;
+}
+
+uint8_t uart_getc_wait(void) {
+	uint16_t c;
+	while ((c = uart_getc()) == UART_NO_DATA) {}
+	return c;
+}
+
+
+
+/*
+ * uart_getc
+ * Gets a single char of a complete line.
+ * return	uint16_r	the received char or UART_NO_DATA 
+ */
+uint16_t uart_getc(void) {
+	return rx_get();
+}
+
+
+
+/*
+ * uart_gets
+ */
+uint8_t uart_gets(char *buf, uint8_t size) {
+	uint8_t count = 0;
+	uint8_t n;
+	if ((rx_count() >= 2) && (rx_peek(0) == '>') && (rx_peek(1) == ' ')) {
+		n = 2;		// the prompt, it has no '\n'
+	}
+	else {
+		n = rx_find('\n');
+	}
+	count = rx_read((uint8_t *)buf, (n < size - 1) ? n : size - 1);
+	rx_skip(n - count);
+	buf[count] = 0;
+	return count;
+}
+
+
+
+/*
+ * SIGNAL RX complete
+ * Receives a char from UART and stores it in ring buffer. When a
+ * line is complete, it is published to the foreground. The "> " 
+ * prompt of AT+CMGS at the start of a line is published as a line of
+ * its own, the chars behind it start the next line. A line that
+ * does not fit into the buffer is dropped as a whole.
+ */
+SIGNAL(USART_RXC_vect) {
+	PROFILE_ENTER(PROFILE_UART_RX, PROFILE_NO_EVENT);
+	uint8_t data = UDR;
+	CAPTURE(CAPTURE_RX, data);
+	if (rx_dropping) {
+		rx_dropping = (data != '\n');
+	}
+	else if (!rx_push(data)) {
+		// buffer overflow, drop the partial line
+		rx_discard();
+		rx_dropping = (data != '\n');
+		uart_dropped++;
+	}
+	else if ((data == '\n') || 
+			((data == ' ') && (rx_pending() == 2) && (rx_staged(1) == '>'))) {
+		rx_commit();
+		IDLE_WAKEUP(WAKE_UART);
+	}
+	PROFILE_EXIT(PROFILE_UART_RX);
+}
+
+
+
+/*
+ * uart_putc_f
+ * Puts a single char. Used by printf functions.
+ */
+int uart_putc_f(char c, FILE *stream) {
+	uart_putc(c);
+    return 0;
+}
+
+void uart_puts(const char *s) {
+    while (*s) {
+        uart_putc(*s);
+        s++;
+    }
+}
+void uart_puts_P(const char *s) {
+	while (pgm_read_byte(s) != 0x00) {
+		uart_putc(pgm_read_byte(s++));
+	}
+}
+
+
+
+/*
+ * Puts a single char.
+ *   uint8_t c	the char to transmit
+ */
+void uart_putc(uint8_t c) {
+	// wait for space in buffer
+	while (!tx_put(c)) {
+		;
+	}
+	// enable uart data interrupt (send data)
+	UCSRB |= (1<<UDRIE);
+}
+
+
+
+/*
+ * SIGNAL User Data Regiser Empty
+ * Send a char out of buffer via UART. If sending is complete, the 
+ * interrupt gets disabled.
+ */
+SIGNAL(USART_UDRE_vect) {
+	PROFILE_ENTER(PROFILE_UART_UDRE, PROFILE_NO_EVENT);
+	uint16_t c = tx_get();
+	if (c != RING_NO_DATA) {
+		UDR = c;
+		CAPTURE(CAPTURE_TX, c);
+	}
+	else {
+		// disable this interrupt if nothing more to send
+		UCSRB &= ~(1 << UDRIE);
+	}
+	PROFILE_EXIT(PROFILE_UART_UDRE);
+}
+
+
+
@@ -1,51 +1,107 @@
-/* ----------------------------------------------------
- * File    : uart.h
- * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
- * Hardware: ATmega8, 4.096MHz
- * Software: WinAVR20070525
- * 
- * Adapted from:
- * Author:   Peter Fleury <pfleury@gmx.ch>   http://jump.to/fleury
- */
-
-#ifndef UART_H_
-#define UART_H_
-
-#include <stdio.h>
-
-#define UART_NO_DATA 0x0100
-
-/*
- * init_uart
- * Initialize UART to 19200 baud with 8N1. 
- */
-void init_uart(void);
-
-/* 
- * uart_getc
- * Sends a single char via UART.
- * return	uint16_r	the received char or UART_NO_DATA 
- */
-uint16_t uart_getc(void);
-uint8_t uart_getc_wait(void);
-int uart_getc_f(FILE *stream);
-
-/*
- * uart_putc
- * Puts a single char via UART.
- * uint8_t c	the char to transmit
- */
-void uart_putc(uint8_t c);
-int uart_putc_f(char c, FILE *stream);
-
-/*
- * uart_puts
- * Sends a string.
- * The string is copied in a buffer. The buffer is transmitted using
- * interrupts.
- * This call blocks until the previous sending is complete.
- */
-void uart_puts(const char *s);
-void uart_puts_P(const char *s);
-
-#endif /*UART_H_*/
+/* ----------------------------------------------------
+ * File    : uart.h
+ * Author  : Alex Weber, alex@tinkerlog.com, http://tinkerlog.com
+ * Hardware: ATmega8, 4.096MHz
+ * Software: WinAVR20070525
+ * 
+ * Adapted from:
+ * Author:   Peter Fleury <pfleury@gmx.ch>   http://jump.to/fleury
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdio.h>
+
+#define UART_NO_DATA 0x0100
+
+// ring sizes, powers of 2
+#define UART_TX_BUFFER_SIZE 32
+#define UART_RX_BUFFER_SIZE 128	// whole lines, a $GPSACP line has about 90 chars
+
+// baud rates, UBRR and U2X are computed at compile time for F_CPU
+#define UART_RATE_9600		0
+#define UART_RATE_19200		1
+#define UART_RATE_38400		2
+#define UART_RATE_57600		3
+#define UART_RATE_115200	4
+#define UART_RATES			5
+#define UART_RATE_DEFAULT	UART_RATE_19200
+#define UART_MAX_ERROR		20		// permille, rates above are not used
+
+// lines dropped because the receive buffer was full
+extern uint16_t uart_dropped;
+
+// the current rate
+extern uint8_t uart_rate;
+
+/*
+ * init_uart
+ * Initialize UART to 19200 baud with 8N1. 
+ */
+void init_uart(void);
+
+/*
+ * uart_baud
+ * Switches to another baud rate after the pending chars are sent.
+ * rate		one of the UART_RATE defines
+ * return	uint8_t	FALSE if the rate is not usable with this F_CPU
+ */
+uint8_t uart_baud(uint8_t rate);
+
+/*
+ * uart_flush
+ * Waits until the transmit buffer is empty.
+ */
+void uart_flush(void);
+
+/*
+ * uart_rate_baud
+ * return	uint32_t	the nominal baud rate of a rate
+ */
+uint32_t uart_rate_baud(uint8_t rate);
+
+/*
+ * uart_rate_error
+ * return	uint8_t	the error of a rate in permille, 0xff if not usable
+ */
+uint8_t uart_rate_error(uint8_t rate);
+
+/* 
+ * uart_getc
+ * Gets a single char. Received chars are passed on only when their
+ * line is complete.
+ * return	uint16_r	the received char or UART_NO_DATA 
+ */
+uint16_t uart_getc(void);
+uint8_t uart_getc_wait(void);
+int uart_getc_f(FILE *stream);
+
+/*
+ * uart_gets
+ * Gets a complete line including its "\r\n", or the "> " prompt of 
+ * AT+CMGS, which ends a line of its own. Chars that do not fit into 
+ * the buffer are dropped.
+ * return	uint8_t	length of the line, 0 if there is none
+ */
+uint8_t uart_gets(char *buf, uint8_t size);
+
+/*
+ * uart_putc
+ * Puts a single char via UART.
+ * uint8_t c	the char to transmit
+ */
+void uart_putc(uint8_t c);
+int uart_putc_f(char c, FILE *stream);
+
+/*
+ * uart_puts
+ * Sends a string.
+ * The string is copied in a buffer. The buffer is transmitted using
+ * interrupts.
+ * This call blocks until the previous sending is complete.
+ */
+void uart_puts(const char *s);
+void uart_puts_P(const char *s);
+
+#endif /*UART_H_*/